@@ -1,6 +1,10 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <SFML/Graphics/RenderWindow.hpp>
@@ -8,6 +12,8 @@
 #include <SFML/Graphics/Font.hpp>
 #include <SFML/Graphics/Text.hpp>
 
+#include "CompileCache.h"
+#include "CompileProgress.h"
 #include "Compiler.h"
 #include "Interpreter.h"
 #include "TuringMachine.h"
@@ -25,6 +31,7 @@ enum class AppMode {
 class App {
 public:
     App();
+    ~App();
 
     /**
      * @brief Обработать событие SFML (ввод пользователя)
@@ -51,9 +58,12 @@ public:
     // Команды пользователя (могут вызываться по клавишам или кнопкам)
     // ============================================================
 
-    /** @brief Скомпилировать исходный код в таблицу переходов */
+    /** @brief Скомпилировать исходный код в таблицу переходов (в фоновом потоке) */
     void requestCompile();
 
+    /** @brief Отменить идущую фоновую компиляцию */
+    void requestCancelCompile();
+
     /** @brief Сбросить машину в начальное состояние */
     void requestResetMachine();
 
@@ -161,6 +171,15 @@ private:
     /** @brief Пометить исходный код как изменённый */
     void markEdited();
 
+    /** @brief Запустить компиляцию текущего кода в фоновом потоке */
+    void startCompile();
+
+    /** @brief Забрать результат завершившейся фоновой компиляции */
+    void pollCompile();
+
+    /** @brief Сделать результат компиляции текущим */
+    void applyCompileResult(CompileResult result);
+
     // ============================================================
     // Состояние приложения
     // ============================================================
@@ -181,6 +200,14 @@ private:
 
     bool sourceDirty_{true};              
     CompileResult lastCompile_{};         
+    CompileCache compileCache_{};         // Разобранные процедуры и таблица прошлой компиляции
+
+    // Фоновая компиляция: пока поток не присоединён, compileCache_ принадлежит ему
+    std::thread compileThread_;
+    std::unique_ptr<CompileProgress> compileProgress_;  // Ход текущей компиляции (nullptr - не идёт)
+    std::mutex compileMutex_;
+    std::optional<CompileResult> finishedCompile_;      // Результат потока, ждёт подмены в update()
+    float autoCompileDelay_{-1.f};                      // Секунд до автоматической компиляции (<0 - не запланирована)
     TuringMachine tm_{};                 
     Interpreter interpreter_{};           
     AppMode mode_{AppMode::IdleEditing};  
@@ -6,12 +6,20 @@
 #include "TransitionTable.h"
 #include "Types.h"
 
+/** @brief Способ доступа операций с переменной к памяти */
+struct VarAccess {
+    bool memoryFollowsHead = false;   // Память вплотную слева от головки (Placement::FollowsHead)
+    bool sharedMarkers = false;       // Одна цепочка на операцию, символ хранится в маркере #<символ>
+};
+
 /** @brief Контекст генерации кода */
 struct CodegenContext {
     TransitionTable* tt;              // Таблица переходов
     StateId nextState;                // Следующий свободный ID
-    std::vector<Symbol> alphabet;     // Алфавит (включая системные)
+    SymbolSpan alphabet;              // Алфавит (включая системные); принадлежит генератору
     bool phaseR = true;               // Фаза: true=справа, false=слева
+    VarAccess access;                 // Размещение памяти и вид маркера
+    SymbolSpan classMembers;          // Члены классов символов (в alphabet только представитель)
     
     StateId allocState() { return nextState++; }
     StateId allocStates(int n) { StateId f = nextState; nextState += n; return f; }
@@ -32,6 +40,13 @@ StateId genGoToBOM(CodegenContext& ctx, StateId entry, StateId exit);
 StateId genGoToEOM(CodegenContext& ctx, StateId entry, StateId exit);
 StateId genGotoBitCell(CodegenContext& ctx, StateId entry, StateId exit, int bitIndex);
 StateId genReturnToUserZone(CodegenContext& ctx, StateId entry, StateId exit);
+// Пустой originalSym - восстановить символ по маркеру #<символ> (VarAccess::sharedMarkers)
+StateId genReturnToMarker(CodegenContext& ctx, StateId entry, StateId exit, const Symbol& originalSym);
+
+// Сдвиг памяти вместе с головкой (Placement::FollowsHead)
+
+StateId genShiftMemoryRight(CodegenContext& ctx, StateId entry, StateId exit);
+StateId genShiftMemoryLeft(CodegenContext& ctx, StateId entry, StateId exit);
 
 // Операции с переменной (8-bit two's complement)
 
@@ -46,7 +61,10 @@ StateId genCmpInt8Const_GT(CodegenContext& ctx, StateId entry,
 // Вспомогательные
 
 void int8ToBits(int value, Symbol bits[8]);
-StateId countVarSetConstStates(const std::vector<Symbol>& alphabet);
-StateId countVarIncStates(const std::vector<Symbol>& alphabet);
-StateId countVarDecStates(const std::vector<Symbol>& alphabet);
-StateId countCmpInt8States(const std::vector<Symbol>& alphabet, int rhs);
+bool addMarkerSymbols(std::vector<Symbol>& alphabet);
+StateId countVarSetConstStates(const std::vector<Symbol>& alphabet, const VarAccess& access = {});
+StateId countVarIncStates(const std::vector<Symbol>& alphabet, const VarAccess& access = {});
+StateId countVarDecStates(const std::vector<Symbol>& alphabet, const VarAccess& access = {});
+StateId countCmpInt8States(const std::vector<Symbol>& alphabet, int rhs, const VarAccess& access = {});
+StateId countShiftMemoryRightStates(SymbolSpan alphabet);
+StateId countShiftMemoryLeftStates(SymbolSpan alphabet);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "IR.h"
+#include "TransitionTable.h"
+#include "TuringMachine.h"
+
+/** @brief Процедура, разобранная в одной из прошлых компиляций */
+struct CachedProcedure {
+    std::unique_ptr<IRArena> arena;   // Узлы тела; живут, пока запись в кэше
+    std::string text;                 // Исходный текст от 'proc' до '}'
+    Procedure procedure;
+    std::vector<std::string> calls;   // Вызываемые процедуры: должны быть объявлены выше
+    bool used{false};                 // Встречена в текущей компиляции
+};
+
+/**
+ * @class CompileCache
+ * @brief Состояние для повторной компиляции одного документа
+ *
+ * Процедуры ищутся по тексту: тело, которое не менялось, не разбирается
+ * заново, а его IR берётся из прошлой компиляции (flatten строит новые
+ * узлы). Если процедура сдвинулась в документе, позиции её узлов сдвигаются
+ * на месте - других изменений тела после разбора нет. Таблица переходов
+ * переиспользуется, если оптимизированный IR, алфавит и начальная лента
+ * совпали с прошлыми: правка комментария, неиспользуемой процедуры или
+ * кода, который оптимизируется в тот же IR, не запускает кодогенерацию.
+ * Если инструкции только сместились по строкам, у таблицы переписываются
+ * отметки строк - результат тот же, что у compile(source).
+ *
+ * Один кэш - один документ и одни настройки Compiler; не потокобезопасен.
+ */
+class CompileCache {
+public:
+    /**
+     * @brief Процедура с тем же текстом или nullptr
+     *
+     * Найденная запись переносится на line:column вместе с позициями узлов
+     * тела. Запись, уже взятая в этой компиляции, повторно не выдаётся.
+     */
+    CachedProcedure* findProcedure(std::string_view text, int line, int column);
+
+    /** @brief Запомнить разобранную процедуру */
+    void storeProcedure(std::unique_ptr<CachedProcedure> entry);
+
+    /** @brief Разобранные тела действительны только для своего алфавита */
+    void useAlphabet(const std::vector<Symbol>& alphabet);
+
+    /** @brief Начало компиляции: сброс статистики и отметок использования */
+    void beginCompile();
+
+    /** @brief Успешная компиляция: забыть процедуры, которых больше нет в тексте */
+    void endCompile();
+
+    // Последняя кодогенерация: по ней решается, нужна ли новая
+    std::unique_ptr<IRArena> programArena;   // Узлы program, созданные при компиляции
+    IRBlock program;                         // Оптимизированный плоский IR
+    std::vector<int> programLines;           // Строки инструкций program в прямом обходе на момент кодогенерации
+    std::vector<Symbol> programAlphabet;     // Алфавит до кодогенерации
+    Tape programTape;                        // Начальная лента
+    std::vector<Symbol> tableAlphabet;       // Алфавит после кодогенерации (с маркерами)
+    TransitionTable table;                   // С отметками строк для programLines
+    bool hasTable{false};
+
+    // Статистика последней компиляции
+    std::size_t reusedProcedures{0};
+    std::size_t parsedProcedures{0};
+    bool reusedTable{false};
+
+private:
+    std::vector<Symbol> alphabet_;
+    std::unordered_map<std::size_t, std::unique_ptr<CachedProcedure>> procedures_;
+    // Вытесненные записи: на их узлы ещё может ссылаться program
+    std::vector<std::unique_ptr<CachedProcedure>> retired_;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+/** @brief Этап компиляции для индикатора хода */
+enum class CompilePhase {
+    Queued,
+    Parsing,
+    Flattening,
+    Optimizing,
+    Codegen,
+    TableOptimizing,
+    Done
+};
+
+/**
+ * @class CompileProgress
+ * @brief Ход и отмена компиляции, идущей в другом потоке
+ *
+ * Компилятор пишет этап и долю выполненного, поток интерфейса читает их и
+ * может запросить отмену. Парсер и кодогенерация проверяют отмену между
+ * инструкциями, компилятор - между этапами. Отменённая компиляция
+ * возвращает ok == false и не сохраняет ничего ни в кэш документа, ни на диск.
+ */
+class CompileProgress {
+public:
+    /** @brief Запросить отмену (из любого потока) */
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    /** @brief Текущий этап и выполненная часть: done из total */
+    void report(CompilePhase phase, std::size_t done, std::size_t total) {
+        phase_.store(phase, std::memory_order_relaxed);
+        permille_.store(total > 0 ? static_cast<unsigned>(std::min(done, total) * 1000 / total) : 0,
+                        std::memory_order_relaxed);
+    }
+
+    CompilePhase phase() const { return phase_.load(std::memory_order_relaxed); }
+
+    /** @brief Доля текущего этапа от 0 до 1 */
+    float fraction() const { return static_cast<float>(permille_.load(std::memory_order_relaxed)) / 1000.f; }
+
+private:
+    std::atomic<bool> cancelled_{false};
+    std::atomic<CompilePhase> phase_{CompilePhase::Queued};
+    std::atomic<unsigned> permille_{0};
+};
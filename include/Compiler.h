@@ -1,9 +1,15 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
 #include <string_view>
 #include <vector>
 
+#include "CompileProgress.h"
 #include "Diagnostics.h"
+#include "DiskCache.h"
+#include "IRPasses.h"
+#include "TransitionGenerator.h"
 #include "TransitionTable.h"
 #include "TuringMachine.h"
 
@@ -17,17 +23,59 @@ struct CompileResult {
     std::vector<Diagnostic> diagnostics;
     std::vector<Symbol> alphabet;
     Tape initialTape;
+    // Ленивая кодогенерация (CompileOptions::lazyCodegen): переходы берутся отсюда,
+    // в table только startState и haltState
+    std::shared_ptr<const LazyTransitions> lazy;
 };
 
+/**
+ * @struct CompileOptions
+ * @brief Настройки оптимизаций компилятора
+ */
+struct CompileOptions {
+    bool foldStayTransitions{true};   // Свёртка Stay-переходов в предшественников
+    bool pruneImpossibleRules{true};  // Удаление правил для символов, которых нет под головкой
+    bool trackVariable{true};         // Отслеживание значения x по IR
+    std::size_t unrollBudget{64};     // Предел инструкций при развёртке циклов по x
+    IRPassOptions irPasses;           // Peephole-проходы по IR
+    CodegenOptions codegen;           // Стратегии генерации переходов
+    DiskCacheOptions diskCache;       // Кэш результатов на диске (выключен без каталога)
+    bool lazyCodegen{false};          // Переходы генерируются при первом входе в состояние; кэши не используются
+};
+
+class CompileCache;
+
 /** @class Compiler
  *  @brief Компилятор языка программирования машины Тьюринга
  */
 class Compiler {
 public:
+    Compiler() = default;
+    explicit Compiler(const CompileOptions& options) : options_(options) {}
+
     /**
      * @brief Скомпилировать исходный код в таблицу переходов
      * @param source Исходный код программы
      * @return Результат компиляции с таблицей и диагностикой
      */
     CompileResult compile(std::string_view source) const;
+
+    /**
+     * @brief Повторная компиляция документа после правки
+     * @param cache Кэш этого документа (см. CompileCache); результат тот же, что у compile(source)
+     */
+    CompileResult compile(std::string_view source, CompileCache& cache) const;
+
+    /**
+     * @brief Компиляция в фоновом потоке
+     * @param progress Ход для интерфейса и отмена; отменённая компиляция - ok == false
+     */
+    CompileResult compile(std::string_view source, CompileCache& cache, CompileProgress& progress) const;
+
+private:
+    /** @brief Через кэш на диске, если он включён */
+    CompileResult compileImpl(std::string_view source, CompileCache* cache, CompileProgress* progress) const;
+    CompileResult compileSource(std::string_view source, CompileCache* cache, CompileProgress* progress) const;
+
+    CompileOptions options_;
 };
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <memory>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -21,70 +20,36 @@ enum class ConditionType {
     VarGtConst   // x > <константа>
 };
 
+/**
+ * @brief Предел вложенности блоков и скобок в условиях
+ *
+ * Разбор, проходы IR и генерация рекурсивны по вложенности; предел
+ * ограничивает глубину стека на любом входе.
+ */
+constexpr int kMaxNestingDepth = 256;
+
 struct Condition;
-using ConditionPtr = std::shared_ptr<Condition>;
+struct IRArena;
+// Узлы принадлежат IRArena компиляции и после создания не меняются
+using ConditionPtr = const Condition*;
 
 /** @brief Узел дерева условий (AST) */
 struct Condition {
     ConditionType type;
     std::string symbol;
     int intValue{0};        // Для VarLtConst - правая часть сравнения
-    ConditionPtr left;
-    ConditionPtr right;
-    ConditionPtr operand;
+    ConditionPtr left{nullptr};
+    ConditionPtr right{nullptr};
+    ConditionPtr operand{nullptr};
     int line{0};
     int column{0};
 
-    static ConditionPtr readEq(const std::string& sym, int l, int c) {
-        auto cond = std::make_shared<Condition>();
-        cond->type = ConditionType::ReadEq;
-        cond->symbol = sym;
-        cond->line = l;
-        cond->column = c;
-        return cond;
-    }
-
-    static ConditionPtr readNeq(const std::string& sym, int l, int c) {
-        auto cond = std::make_shared<Condition>();
-        cond->type = ConditionType::ReadNeq;
-        cond->symbol = sym;
-        cond->line = l;
-        cond->column = c;
-        return cond;
-    }
-
-    static ConditionPtr binaryOp(ConditionType t, ConditionPtr l, ConditionPtr r) {
-        auto cond = std::make_shared<Condition>();
-        cond->type = t;
-        cond->left = l;
-        cond->right = r;
-        return cond;
-    }
-
-    static ConditionPtr notOp(ConditionPtr op) {
-        auto cond = std::make_shared<Condition>();
-        cond->type = ConditionType::Not;
-        cond->operand = op;
-        return cond;
-    }
-
-    static ConditionPtr varLtConst(int value, int l, int c) {
-        auto cond = std::make_shared<Condition>();
-        cond->type = ConditionType::VarLtConst;
-        cond->intValue = value;
-        cond->line = l;
-        cond->column = c;
-        return cond;
-    }
-
-    static ConditionPtr varGtConst(int value, int l, int c) {
-        auto cond = std::make_shared<Condition>();
-        cond->type = ConditionType::VarGtConst;
-        cond->intValue = value;
-        cond->line = l;
-        cond->column = c;
-        return cond;
-    }
+    static ConditionPtr readEq(IRArena& arena, const std::string& sym, int l, int c);
+    static ConditionPtr readNeq(IRArena& arena, const std::string& sym, int l, int c);
+    static ConditionPtr binaryOp(IRArena& arena, ConditionType t, ConditionPtr l, ConditionPtr r);
+    static ConditionPtr notOp(IRArena& arena, ConditionPtr op);
+    static ConditionPtr varLtConst(IRArena& arena, int value, int l, int c);
+    static ConditionPtr varGtConst(IRArena& arena, int value, int l, int c);
 };
 
 /** @brief Вычисление логического условия для текущего символа */
@@ -104,6 +69,7 @@ public:
         Token& currentToken,
         const std::unordered_set<Symbol>& alphabetSet,
         const Symbol& blankSymbol,
+        IRArena& arena,
         std::vector<Diagnostic>& diagnostics,
         bool& ok);
 
@@ -114,8 +80,10 @@ private:
     Token& token_;
     const std::unordered_set<Symbol>& alphabetSet_;
     const Symbol& blankSymbol_;
+    IRArena& arena_;
     std::vector<Diagnostic>& diagnostics_;
     bool& ok_;
+    int depth_ = 0;         // Текущая вложенность скобок и not
 
     void error(int line, int col, const std::string& msg);
     ConditionPtr parseOr();
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+struct CompileResult;
+
+/** @brief Настройки кэша результатов компиляции на диске */
+struct DiskCacheOptions {
+    std::filesystem::path directory;        // Каталог кэша; пустой - кэш выключен
+    std::uintmax_t maxBytes{64u << 20};     // Предел суммарного размера записей
+};
+
+/**
+ * @class DiskCache
+ * @brief Результаты компиляции на диске, адресуемые содержимым
+ *
+ * Ключ записи - хеш исходного текста вместе с отпечатком компилятора
+ * (версия кодогенерации и настройки, влияющие на результат). Сам текст и
+ * отпечаток хранятся в записи и сверяются при чтении, так что совпадение
+ * хешей не даёт чужой результат. Запись пишется во временный файл и
+ * переименовывается, поэтому несколько процессов могут делить каталог.
+ *
+ * Время изменения файла - время последнего использования; при превышении
+ * maxBytes удаляются самые давно использованные записи. Ошибки файловой
+ * системы не мешают компиляции: кэш просто не срабатывает.
+ */
+class DiskCache {
+public:
+    DiskCache(DiskCacheOptions options, std::string fingerprint);
+
+    /** @brief Прочитать результат для source (false - записи нет или она повреждена) */
+    bool load(std::string_view source, CompileResult& out) const;
+
+    /** @brief Сохранить результат и вытеснить старые записи сверх предела */
+    void store(std::string_view source, const CompileResult& result) const;
+
+private:
+    std::filesystem::path entryPath(std::string_view source) const;
+    void evict() const;
+
+    DiskCacheOptions options_;
+    std::string fingerprint_;
+};
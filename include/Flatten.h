@@ -8,10 +8,21 @@
 #include "Diagnostics.h"
 #include "IR.h"
 
+/**
+ * @brief Развёрнутые тела процедур одной компиляции
+ *
+ * Тело разворачивается при первом вызове; остальные вызовы вставляют те же
+ * узлы и помечают if/while среди них shared, поэтому затраты линейны по
+ * графу вызовов.
+ */
+using FlattenMemo = std::unordered_map<std::string, IRBlock>;
+
 /** @brief Разворачивает вызовы процедур (без рекурсии) в плоский IR */
 bool flattenProcedure(
     const std::string& procName,
     const std::unordered_map<std::string, Procedure>& procedures,
+    IRArena& arena,
     IRBlock& output,
     std::unordered_set<std::string>& callStack,
+    FlattenMemo& memo,
     std::vector<Diagnostic>& diagnostics);
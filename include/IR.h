@@ -1,10 +1,10 @@
 #pragma once
 
-#include <memory>
 #include <string>
 #include <vector>
 
 #include "Condition.h"
+#include "NodePool.h"
 
 /** @brief Типы IR инструкций */
 enum class IRType {
@@ -20,26 +20,42 @@ enum class IRType {
 };
 
 struct IRInstruction;
-using IRBlock = std::vector<std::shared_ptr<IRInstruction>>;
+// Узлы принадлежат IRArena компиляции; один узел может входить в несколько блоков
+using IRBlock = std::vector<IRInstruction*>;
 
 /** @brief Инструкция промежуточного представления */
 struct IRInstruction {
     IRType type;
     std::string argument;
     int intValue{0};        // Для VarSetConst - значение константы
-    ConditionPtr condition;
+    ConditionPtr condition{nullptr};
     IRBlock thenBranch;
     IRBlock elseBranch;
     int line;
     int column;
+    // Узел входит в несколько блоков (общее тело процедуры): проходы меняют его
+    // один раз для всех мест, и только преобразованиями, верными в любом контексте.
+    // Ставится только у IfElse/While - листья проходы на месте не меняют
+    bool shared{false};
 
-    static std::shared_ptr<IRInstruction> simple(IRType t, const std::string& arg, int l, int c);
-    static std::shared_ptr<IRInstruction> ifElse(ConditionPtr cond, IRBlock thenB, IRBlock elseB, int l, int c);
-    static std::shared_ptr<IRInstruction> whileLoop(ConditionPtr cond, IRBlock body, int l, int c);
+    static IRInstruction* simple(IRArena& arena, IRType t, const std::string& arg, int l, int c);
+    static IRInstruction* ifElse(IRArena& arena, ConditionPtr cond, IRBlock thenB, IRBlock elseB, int l, int c);
+    static IRInstruction* whileLoop(IRArena& arena, ConditionPtr cond, IRBlock body, int l, int c);
     
-    static std::shared_ptr<IRInstruction> varSetConst(int value, int l, int c);
-    static std::shared_ptr<IRInstruction> varInc(int l, int c);
-    static std::shared_ptr<IRInstruction> varDec(int l, int c);
+    static IRInstruction* varSetConst(IRArena& arena, int value, int l, int c);
+    static IRInstruction* varInc(IRArena& arena, int l, int c);
+    static IRInstruction* varDec(IRArena& arena, int l, int c);
+};
+
+/**
+ * @brief Узлы IR и условий одной компиляции
+ *
+ * Все фабрики IRInstruction и Condition выделяют узлы здесь; узлы живут,
+ * пока жива арена, и освобождаются разом вместе с ней.
+ */
+struct IRArena {
+    NodePool<Condition> conditions;
+    NodePool<IRInstruction> instructions;
 };
 
 /** @brief Процедура - именованный блок инструкций */
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+#include "IR.h"
+
+/**
+ * @brief Проверяет, что головка никогда не уходит левее стартовой позиции
+ *
+ * Консервативная оценка смещения головки по плоскому IR: для каждого блока
+ * считается нижняя граница итогового смещения и минимального смещения по пути.
+ * Цикл, тело которого может сдвинуть головку влево, считается неограниченным.
+ * @return true, если пересечение зоны памяти (фаза L) невозможно
+ */
+bool headStaysInUserZone(const IRBlock& instructions);
+
+/** @brief Есть ли в IR операции или условия с переменной x */
+bool usesVariable(const IRBlock& instructions);
+
+/**
+ * @brief Пользовательские символы, которые программа не различает
+ *
+ * Символ не встречается ни в условиях, ни в write - любое правило для одного
+ * такого символа подходит и остальным. Пробел и символы вида #... не входят.
+ */
+std::vector<Symbol> indistinguishableSymbols(const IRBlock& instructions,
+                                             const std::vector<Symbol>& alphabet);
+
+// Структурное сравнение (без учёта позиции в исходнике)
+
+bool sameCondition(const ConditionPtr& a, const ConditionPtr& b);
+bool sameInstruction(const IRInstruction& a, const IRInstruction& b);
+bool sameBlock(const IRBlock& a, const IRBlock& b);
+
+/** @brief Хеш, согласованный с sameCondition / sameInstruction */
+std::size_t hashCondition(const ConditionPtr& cond);
+std::size_t hashInstruction(const IRInstruction& instr);
+
+/** @brief Добавить хеш value к seed (порядок важен) */
+inline std::size_t hashCombine(std::size_t seed, std::size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "IR.h"
+
+/** @brief Итог одного прохода за весь прогон конвейера */
+struct PassReport {
+    std::string name;
+    std::size_t removed{0};   // Удалённые или упрощённые инструкции
+};
+
+/**
+ * @class IRPassManager
+ * @brief Конвейер проходов над плоским IR между flatten и кодогенерацией
+ *
+ * Проходы запускаются по кругу, пока хотя бы один что-то меняет: удаление
+ * одной конструкции часто открывает другую (пустой if после сокращения движений).
+ */
+class IRPassManager {
+public:
+    /** @brief Проход: меняет блок, возвращает число удалённых инструкций */
+    using Pass = std::function<std::size_t(IRBlock&)>;
+
+    void add(std::string name, Pass pass);
+
+    /** @brief Прогнать конвейер (не больше maxRounds кругов) */
+    std::vector<PassReport> run(IRBlock& instructions, int maxRounds = 4) const;
+
+private:
+    std::vector<std::pair<std::string, Pass>> passes_;
+};
+
+/** @brief Включение отдельных проходов */
+struct IRPassOptions {
+    bool constantConditions{true};   // if/while с условием, не зависящим от символа
+    bool identicalBranches{true};    // if с одинаковыми ветками
+    bool emptyIfs{true};             // if с пустыми ветками
+    bool movePairs{true};            // move_left; move_right и наоборот
+    bool overwrittenWrites{true};    // write, перезаписанный следующим write
+};
+
+// Проходы (рекурсивно по вложенным блокам)
+
+std::size_t removeConstantConditions(IRBlock& block, const std::vector<Symbol>& alphabet);
+std::size_t mergeIdenticalBranches(IRBlock& block);
+std::size_t removeEmptyIfs(IRBlock& block);
+std::size_t cancelMovePairs(IRBlock& block);
+std::size_t removeOverwrittenWrites(IRBlock& block);
+
+/** @brief Добавить включённые в options проходы */
+void addPeepholePasses(IRPassManager& manager, const IRPassOptions& options,
+                       const std::vector<Symbol>& alphabet);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "MachineImage.h"
+#include "TransitionGenerator.h"
 #include "TransitionTable.h"
 #include "TuringMachine.h"
 
@@ -15,4 +17,10 @@ class Interpreter {
 public:
     /** @brief Выполнить один шаг машины Тьюринга */
     StepResult step(TuringMachine& tm, const TransitionTable& table);
+
+    /** @brief Выполнить один шаг по отображённому образу машины */
+    StepResult step(TuringMachine& tm, const MachineImage& image);
+
+    /** @brief Выполнить один шаг, генерируя переходы состояния при первом входе */
+    StepResult step(TuringMachine& tm, const LazyTransitions& table);
 };
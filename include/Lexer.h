@@ -1,7 +1,6 @@
 #pragma once
 
 #include <cstddef>
-#include <string>
 #include <string_view>
 
 /** @brief Типы токенов исходного кода */
@@ -28,12 +27,20 @@ enum class TokenType {
 /** @brief Представление лексемы */
 struct Token {
     TokenType type{TokenType::Eof};
-    std::string value;
+    std::string_view value;   // Срез исходного текста: действителен, пока жив источник
     int line{1};
     int column{1};
 };
 
-/** @brief Лексический анализатор */
+/** @brief Значение числового литерала (false - не помещается в int) */
+bool parseNumber(std::string_view text, int& value);
+
+/**
+ * @brief Лексический анализатор
+ *
+ * Не копирует текст: значения токенов ссылаются на source, поэтому
+ * источник должен пережить и лексер, и все полученные токены.
+ */
 class Lexer {
 public:
     explicit Lexer(std::string_view source);
@@ -42,9 +49,13 @@ public:
 
     int line() const { return line_; }
     int column() const { return column_; }
+    /** @brief Смещение следующего непрочитанного символа в source */
+    std::size_t position() const { return pos_; }
 
 private:
     void advance();
+    void advanceInLine(std::size_t count);
+    Token take(TokenType type, std::size_t length, int startLine, int startCol);
     void skipWhitespace();
     Token readStringLiteral(int startLine, int startCol);
     Token readIdentifier(int startLine, int startCol);
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#include "TransitionTable.h"
+#include "TuringMachine.h"
+#include "Types.h"
+
+struct CompileResult;
+
+/**
+ * @brief Двоичный образ скомпилированной машины (.tmi)
+ *
+ * Файл читается через mmap без разбора: все секции выровнены на 8 байт и
+ * лежат массивами фиксированных структур, адреса секций - в заголовке.
+ *
+ *   ImageHeader
+ *   ImageSymbol[symbolCount]      - символы, отсортированные по имени; id = индекс
+ *   uint32_t[stateCount + 1]      - начало строки правил каждого состояния (CSR)
+ *   ImageRule[ruleCount]          - правила, внутри состояния по возрастанию символа
+ *   ImageRule[stateCount]         - правило по умолчанию (symbol == kImageNoSymbol - нет)
+ *   ImageCell[tapeCellCount]      - начальная лента по возрастанию позиции
+ *   ImageSourceLine[sourceLineCount] - первое состояние диапазона -> строка кода
+ *   char[stringBytes]             - имена символов
+ *
+ * Порядок байт - машины, записавшей файл (проверяется по byteOrder).
+ */
+namespace MachineImageFormat {
+
+constexpr char kMagic[8] = {'T', 'M', 'I', 'M', 'A', 'G', 'E', '\0'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kByteOrderMark = 0x01020304;
+constexpr std::uint32_t kNoSymbol = 0xFFFFFFFF;     // Нет символа / нет правила
+constexpr std::uint32_t kKeepSymbol = 0xFFFFFFFE;   // writeSymbol: оставить прочитанный
+
+struct ImageHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t headerSize;
+    std::uint32_t byteOrder;
+    std::uint32_t stateCount;
+    std::uint32_t symbolCount;
+    std::uint32_t ruleCount;
+    std::int32_t startState;
+    std::int32_t haltState;
+    std::uint32_t blankSymbol;
+    std::uint32_t tapeCellCount;
+    std::uint32_t sourceLineCount;
+    std::uint32_t reserved;
+    std::uint64_t symbolsOffset;
+    std::uint64_t rowsOffset;
+    std::uint64_t rulesOffset;
+    std::uint64_t defaultsOffset;
+    std::uint64_t tapeOffset;
+    std::uint64_t sourceLinesOffset;
+    std::uint64_t stringsOffset;
+    std::uint64_t stringBytes;
+};
+
+struct ImageSymbol {
+    std::uint32_t nameOffset;       // Смещение имени в секции строк
+    std::uint32_t nameLength;
+    std::uint32_t representative;   // Представитель класса (сам символ, если не член класса)
+    std::uint32_t reserved;
+};
+
+struct ImageRule {
+    std::uint32_t symbol;
+    std::int32_t nextState;
+    std::uint32_t writeSymbol;      // id или kKeepSymbol
+    std::uint32_t move;             // Move
+};
+
+struct ImageCell {
+    std::int64_t position;
+    std::uint32_t symbol;
+    std::uint32_t reserved;
+};
+
+struct ImageSourceLine {
+    std::int32_t firstState;
+    std::int32_t line;
+};
+
+static_assert(sizeof(ImageHeader) == 120, "ImageHeader layout");
+static_assert(sizeof(ImageSymbol) == 16 && sizeof(ImageRule) == 16 &&
+              sizeof(ImageCell) == 16 && sizeof(ImageSourceLine) == 8, "image record layout");
+
+} // namespace MachineImageFormat
+
+/** @brief Записать таблицу, ленту и карту строк результата в файл образа */
+bool writeMachineImage(const CompileResult& result, const std::filesystem::path& path);
+
+/** @brief Переход из образа: символы - id образа */
+struct ImageTransition {
+    StateId nextState{0};
+    std::uint32_t writeSymbol{MachineImageFormat::kNoSymbol};
+    Move move{Move::Stay};
+};
+
+/**
+ * @class MachineImage
+ * @brief Образ машины, отображённый в память только для чтения
+ *
+ * open() проверяет заголовок и границы секций, но ничего не копирует и не
+ * разбирает: страницы читаются по мере обращения и делятся между процессами,
+ * открывшими тот же файл. lookup() повторяет TransitionTable::lookup.
+ */
+class MachineImage {
+public:
+    MachineImage() = default;
+    ~MachineImage();
+    MachineImage(const MachineImage&) = delete;
+    MachineImage& operator=(const MachineImage&) = delete;
+
+    /** @brief Отобразить файл (false - файла нет или это не образ этой версии) */
+    bool open(const std::filesystem::path& path);
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+    StateId startState() const { return header_->startState; }
+    StateId haltState() const { return header_->haltState; }
+    std::size_t stateCount() const { return header_->stateCount; }
+    std::size_t symbolCount() const { return header_->symbolCount; }
+    std::size_t ruleCount() const { return header_->ruleCount; }
+
+    /** @brief Имя символа по id */
+    std::string_view symbolName(std::uint32_t symbol) const;
+
+    /** @brief id символа (двоичный поиск) или kNoSymbol */
+    std::uint32_t findSymbol(std::string_view name) const;
+
+    /** @brief Переход для символа с учётом классов и правил по умолчанию */
+    bool lookup(StateId state, std::uint32_t symbol, ImageTransition& out) const;
+
+    /** @brief Строка исходного кода, породившая состояние (0 - неизвестна) */
+    int sourceLine(StateId state) const;
+
+    /** @brief Начальная лента */
+    Tape initialTape() const;
+
+    /** @brief Таблица в памяти (копия всех правил) */
+    TransitionTable toTable() const;
+
+private:
+    template <typename T>
+    const T* section(std::uint64_t offset) const {
+        return reinterpret_cast<const T*>(data_ + offset);
+    }
+    const MachineImageFormat::ImageRule* findRule(StateId state, std::uint32_t symbol) const;
+
+    const unsigned char* data_{nullptr};
+    std::size_t size_{0};
+    const MachineImageFormat::ImageHeader* header_{nullptr};
+#ifdef _WIN32
+    void* file_{nullptr};
+    void* mapping_{nullptr};
+#endif
+};
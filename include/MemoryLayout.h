@@ -5,6 +5,15 @@
 /** @brief Константы разметки системной памяти на ленте */
 namespace MemoryLayout {
 
+/**
+ * @brief Размещение блока памяти на ленте
+ *
+ * Fixed - блок всегда на позициях -10..-1, переменная доступна обходом до него.
+ * FollowsHead - блок вплотную слева от головки и сдвигается вместе с ней;
+ * позиции ниже отсчитываются от головки, а не от нуля.
+ */
+enum class Placement { Fixed, FollowsHead };
+
 // Позиции на ленте
 inline constexpr long long kMemBegin     = -10;  // BOM (начало памяти)
 inline constexpr long long kMemEnd       = -1;   // EOM (конец памяти)
@@ -20,6 +29,11 @@ inline const Symbol kBit0      = "0_";    // Бит 0
 inline const Symbol kBit1      = "1_";    // Бит 1
 inline const Symbol kPosMarker = "#";     // Маркер позиции
 
+/** @brief Маркер позиции, запоминающий символ под головкой */
+inline Symbol markerFor(const Symbol& sym) {
+    return kPosMarker + (sym == " " ? std::string("blank") : sym);
+}
+
 /** @brief Позиция бита на ленте (0=MSB, 7=LSB) */
 inline constexpr long long bitPosition(int bitIndex) {
     return kMSBPosition + bitIndex;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+
+/**
+ * @brief Пул узлов одного типа
+ *
+ * Узлы выделяются блоками и живут, пока жив пул; адреса не меняются.
+ * Освобождать отдельные узлы не нужно - всё уходит вместе с пулом.
+ */
+template <typename T>
+class NodePool {
+public:
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    /** @brief Новый узел со значениями по умолчанию */
+    T* create() {
+        nodes_.emplace_back();
+        return &nodes_.back();
+    }
+
+    /** @brief Количество выделенных узлов */
+    std::size_t size() const { return nodes_.size(); }
+
+    /** @brief Обойти все узлы пула */
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        for (T& node : nodes_) {
+            fn(node);
+        }
+    }
+
+private:
+    std::deque<T> nodes_;
+};
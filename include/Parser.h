@@ -0,0 +1,91 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "CompileCache.h"
+#include "CompileProgress.h"
+#include "Compiler.h"
+#include "IR.h"
+#include "Lexer.h"
+
+/**
+ * @class Parser
+ * @brief Разбор программы рекурсивным спуском по потоку токенов
+ *
+ * Объявления (Set_alphabet, Setup, proc) и тела процедур разбираются за один
+ * проход; IR строится сразу в арене компиляции. Каждый блок - один вызов
+ * parseBlock, цепочка else if - цикл, поэтому глубина рекурсии равна
+ * вложенности блоков и ограничена kMaxNestingDepth.
+ *
+ * Алфавит, начальная лента и диагностика пишутся в result; разбор
+ * останавливается на первой ошибке. С кэшем тело процедуры, текст которой
+ * не менялся, не разбирается: лексер только находит парную '}'. С progress
+ * разбор сообщает долю прочитанного текста и проверяет отмену перед каждой
+ * инструкцией.
+ */
+class Parser {
+public:
+    Parser(std::string_view source, IRArena& arena, CompileResult& result, CompileCache* cache = nullptr,
+           CompileProgress* progress = nullptr);
+
+    /** @brief Разобрать программу целиком */
+    void parse();
+
+    const std::unordered_map<std::string, Procedure>& procedures() const { return procedures_; }
+    bool alphabetDefined() const { return alphabetDefined_; }
+    bool setupDefined() const { return setupDefined_; }
+
+private:
+    void advance() { token_ = lexer_.next(); }
+    void error(int line, int col, const std::string& msg);
+    bool expect(TokenType expected, const std::string& what);
+    /** @brief Отмена запрошена: разбор останавливается как на ошибке */
+    bool cancelled();
+
+    // Объявления верхнего уровня
+    void parseSetAlphabet(int line, int col);
+    void parseSetup(int line, int col);
+    void parseProcHeader(int line, int col);
+
+    /**
+     * @brief Инструкция, начинающаяся с идентификатора, в конец out
+     * @param context Конструкция, в блоке которой стоит инструкция ("if", "while", ...);
+     *                nullptr - тело процедуры
+     */
+    bool parseStatement(IRBlock& out, const char* context, int depth);
+    /** @brief Инструкции до '}' включительно (открывающая '{' уже прочитана) */
+    bool parseBlock(IRBlock& out, const char* context, int depth);
+    /** @brief ( условие ) { - условие if/while и открывающая скобка тела */
+    ConditionPtr parseHeader();
+    IRInstruction* parseIf(int line, int col, int depth);
+    IRInstruction* parseWhile(int line, int col, int depth);
+    IRInstruction* parseVarOp(int line, int col);
+    /** @brief Символ из строкового литерала ("blank" - пустой символ) */
+    bool parseSymbol(Symbol& out);
+
+    /** @brief Взять тело из кэша (лексер встаёт на '}') или разбирать его в арену новой записи */
+    void beginCachedBody(const Token& procToken);
+    /** @brief Тело разобрано: записать процедуру в кэш */
+    void finishCachedBody();
+
+    std::string_view source_;
+    Lexer lexer_;
+    Token token_;
+    IRArena& compileArena_;
+    IRArena* arena_;                              // Куда строится IR: арена компиляции или записи кэша
+    CompileResult& result_;
+    CompileCache* cache_;
+    CompileProgress* progress_;
+    std::unique_ptr<CachedProcedure> pending_;    // Запись кэша для разбираемого тела
+
+    const Symbol blankSymbol_ = " ";
+    std::unordered_set<Symbol> alphabetSet_;
+    std::unordered_map<std::string, Procedure> procedures_;
+    Procedure* currentProc_ = nullptr;
+    bool alphabetDefined_ = false;
+    bool setupDefined_ = false;
+};
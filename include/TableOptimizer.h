@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+#include <vector>
+
+#include "CompileProgress.h"
+#include "TransitionTable.h"
+#include "TuringMachine.h"
+
+/**
+ * @brief Свёртка Stay-переходов в предшественников
+ *
+ * Правило (s, a) -> (t, w, Stay) заменяется правилом состояния t для символа w:
+ * головка не сдвинулась, значит t гарантированно прочитает w. Так write + move
+ * и проверка условия + первое действие ветки выполняются за один шаг.
+ * @return Количество изменённых правил
+ */
+std::size_t foldStayTransitions(TransitionTable& table);
+
+/** @brief Удалить правила состояний, недостижимых из startState */
+std::size_t removeUnreachableStates(TransitionTable& table);
+
+/**
+ * @brief Удалить правила для символов, которых не может быть под головкой
+ *
+ * Абстрактная интерпретация таблицы: для каждого состояния - множество пар
+ * (позиция головки, символ под ней). Позиция - зона левее памяти, одна из
+ * клеток памяти или пользовательская зона. Содержимое клеток памяти берётся
+ * из initialTape, пользовательской зоны - из tapeSymbols, и пополняется
+ * записями. Правило, которое ни разу не срабатывает, удаляется, как и все
+ * правила недостижимых состояний.
+ *
+ * Только для фиксированной памяти (Placement::Fixed): при памяти у головки
+ * клетки памяти не привязаны к позициям ленты.
+ * @param progress Отмена: анализ прерывается, таблица не меняется
+ * @return Количество удалённых правил
+ */
+std::size_t removeImpossibleTransitions(TransitionTable& table, const Tape& initialTape,
+                                        const std::vector<Symbol>& tapeSymbols,
+                                        const CompileProgress* progress = nullptr);
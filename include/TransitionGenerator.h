@@ -1,13 +1,94 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
 #include <vector>
 
+#include "CompileProgress.h"
 #include "Condition.h"
 #include "IR.h"
+#include "MemoryLayout.h"
 #include "TransitionTable.h"
 
-/** @brief Генерация таблицы переходов МТ из плоского IR */
+/** @brief Стратегии кодогенерации */
+struct CodegenOptions {
+    // Проверка EOM/BOM во входе следующей инструкции вместо отдельного состояния afterMove
+    bool mergeBoundaryChecks{true};
+    // Не генерировать фазу L, если анализ IR доказал, что головка не пересекает память
+    bool elideUnreachablePhase{true};
+    // Размещение памяти. FollowsHead: переменная в O(1) шагов, но каждый сдвиг
+    // головки переносит блок памяти (~20 шагов)
+    MemoryLayout::Placement memoryPlacement{MemoryLayout::Placement::Fixed};
+    // Одна цепочка на операцию с переменной вместо копии на каждый символ;
+    // алфавит должен содержать маркеры #<символ> (addMarkerSymbols)
+    bool sharedMarkerChains{true};
+    // Условие без сравнений x - одно состояние по таблице истинности символов
+    bool compileReadConditions{true};
+    // while (<условие по символу>) { move; } - одно состояние с переходом в себя
+    bool lowerScanLoops{true};
+    // if / else if по символу - одно состояние выбора ветки
+    bool dispatchElseIfChains{true};
+    // Одинаковые хвосты блоков с общим выходом - одна копия, остальные переходят в неё
+    bool shareIdenticalTails{true};
+    // Символы, которые программа не проверяет и не пишет, - один класс в таблице
+    bool symbolClasses{true};
+    // Фазы R и L (непересекающиеся диапазоны состояний) генерируются в разных потоках
+    bool parallelPhases{true};
+};
+
+/**
+ * @brief Генерация таблицы переходов МТ из плоского IR
+ * @param progress Доля сгенерированных состояний; после отмены таблица неполная
+ */
 void generateTransitions(
     const IRBlock& instructions,
     const std::vector<Symbol>& alphabet,
-    TransitionTable& table);
+    TransitionTable& table,
+    const CodegenOptions& options = {},
+    CompileProgress* progress = nullptr);
+
+/**
+ * @class LazyTransitions
+ * @brief Таблица переходов, генерируемая по требованию
+ *
+ * Диапазоны состояний всех инструкций раскладываются сразу (как в
+ * generateTransitions), но переходы инструкции генерируются, только когда
+ * машина впервые входит в её диапазон; вложенные блоки при этом снова
+ * откладываются. Время до первого шага пропорционально коду, который
+ * действительно выполняется, а не размеру программы.
+ *
+ * Общие хвосты (shareIdenticalTails) выключены: их поиск зависит от порядка
+ * генерации. Проходы по готовой таблице (свёртка Stay, удаление правил) не
+ * выполняются - им нужна вся таблица. lookup() можно вызывать из нескольких
+ * потоков: сгенерированная часть читается под разделяемой блокировкой.
+ */
+class LazyTransitions {
+public:
+    /**
+     * @param instructions Оптимизированный плоский IR
+     * @param arena Владелец узлов instructions: живёт вместе с таблицей
+     */
+    LazyTransitions(IRBlock instructions, std::unique_ptr<IRArena> arena,
+                    const std::vector<Symbol>& alphabet, const CodegenOptions& options = {});
+    ~LazyTransitions();
+    LazyTransitions(const LazyTransitions&) = delete;
+    LazyTransitions& operator=(const LazyTransitions&) = delete;
+
+    StateId startState() const;
+    StateId haltState() const;
+
+    /** @brief Как TransitionTable::lookup; при первом входе в состояние генерирует его переходы */
+    bool lookup(StateId state, const Symbol& symbol, Transition& out) const;
+
+    /** @brief Копия уже сгенерированной части таблицы */
+    TransitionTable snapshot() const;
+
+    /** @brief Сколько инструкций ещё не сгенерировано */
+    std::size_t pendingInstructions() const;
+
+private:
+    struct Generator;
+    std::unique_ptr<Generator> generator_;
+    mutable std::shared_mutex mutex_;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -9,6 +10,9 @@
 #include "Diagnostics.h"
 #include "Types.h"
 
+/** @brief writeSymbol правила по умолчанию: оставить прочитанный символ */
+inline const Symbol kKeepSymbol = "";
+
 /** @brief Одно правило перехода машины Тьюринга */
 struct Transition {
     StateId nextState{0};
@@ -28,9 +32,108 @@ public:
     /** @brief Проверить наличие перехода */
     bool has(StateId state, Symbol symbol) const;
 
-    /** @brief Получить переход (nullptr если не найден) */
+    /** @brief Получить переход (nullptr если не найден); классы символов не учитываются */
     const Transition* get(StateId state, Symbol symbol) const;
 
+    /**
+     * @brief Переход для символа с учётом классов и правил по умолчанию (false - правила нет)
+     *
+     * Порядок: собственное правило, правило представителя класса, правило
+     * состояния по умолчанию. Правило представителя, оставляющее его на ленте,
+     * для члена класса оставляет сам символ.
+     */
+    bool lookup(StateId state, const Symbol& symbol, Transition& out) const;
+
+    /**
+     * @brief Правило состояния для всех символов без собственного правила
+     *
+     * writeSymbol == kKeepSymbol - оставить символ под головкой.
+     * Одно правило вместо |алфавит| одинаковых: "сдвиг", "запись W".
+     */
+    void setDefault(StateId state, const Transition& transition);
+
+    /** @brief Правило по умолчанию (nullptr если нет) */
+    const Transition* getDefault(StateId state) const;
+
+    /** @brief Обойти правила по умолчанию: fn(state, transition) */
+    template <typename Fn>
+    void forEachDefault(Fn&& fn) const {
+        for (const auto& kv : defaults_) {
+            fn(kv.first, kv.second);
+        }
+    }
+
+    /** @brief Удалить правила по умолчанию состояний, для которых pred(state) == true */
+    std::size_t eraseDefaults(const std::function<bool(StateId)>& pred);
+
+    /**
+     * @brief Классы неразличимых символов: член класса -> представитель
+     *
+     * Задаётся до генерации. Правила пишутся только для представителя;
+     * собственные правила члена класса (например, запись маркера #<символ>)
+     * по-прежнему допустимы и имеют приоритет.
+     */
+    void setSymbolClasses(std::unordered_map<Symbol, Symbol> representatives);
+
+    /** @brief Классы символов: член класса -> представитель */
+    const std::unordered_map<Symbol, Symbol>& symbolClasses() const { return representatives_; }
+
+    /** @brief Представитель класса символа (сам символ, если он не член класса) */
+    const Symbol& representative(const Symbol& symbol) const;
+
+    /** @brief Символ представляет класс из нескольких символов */
+    bool isClassRepresentative(const Symbol& symbol) const { return classRepresentatives_.count(symbol) > 0; }
+
+    /** @brief У состояния есть собственные правила членов классов */
+    bool hasMemberRules(StateId state) const { return memberRuleStates_.count(state) > 0; }
+
+    /** @brief Заменить правило перехода (или добавить, если его не было) */
+    void set(StateId state, const Symbol& symbol, const Transition& transition);
+
+    /**
+     * @brief Перенести в таблицу все правила shard
+     *
+     * Для сборки таблицы из частей, сгенерированных независимо (например, в
+     * разных потоках). Совпадающие правила заменяются правилами shard.
+     */
+    void merge(TransitionTable&& shard);
+
+    /**
+     * @brief Исходная строка состояний начиная с first (до следующей отметки)
+     *
+     * Кодогенерация отмечает первое состояние каждой инструкции; вложенные
+     * блоки отмечают свои диапазоны. line == 0 - служебные состояния без строки.
+     */
+    void setSourceLine(StateId first, int line);
+
+    /** @brief Строка исходного кода, породившая состояние (0 - неизвестна) */
+    int sourceLine(StateId state) const;
+
+    /** @brief Обойти отметки строк по возрастанию состояний: fn(first, line) */
+    template <typename Fn>
+    void forEachSourceLine(Fn&& fn) const {
+        for (const auto& kv : sourceLines_) {
+            fn(kv.first, kv.second);
+        }
+    }
+
+    /** @brief Удалить все правила состояний, для которых pred(state) == true */
+    std::size_t eraseStates(const std::function<bool(StateId)>& pred);
+
+    /** @brief Удалить правила, для которых pred(state, symbol) == true */
+    std::size_t eraseRules(const std::function<bool(StateId, const Symbol&)>& pred);
+
+    /** @brief Обойти все правила: fn(state, symbol, transition) */
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const auto& kv : transitions_) {
+            fn(kv.first.state, kv.first.symbol, kv.second);
+        }
+    }
+
+    /** @brief Количество правил перехода (вместе с правилами по умолчанию) */
+    std::size_t size() const { return transitions_.size() + defaults_.size(); }
+
     /** @brief Получить все состояния */
     std::vector<StateId> states() const;
 
@@ -58,4 +161,10 @@ private:
     };
 
     std::unordered_map<Key, Transition, KeyHash> transitions_;
+    std::unordered_map<StateId, Transition> defaults_;
+
+    std::unordered_map<Symbol, Symbol> representatives_;   // Член класса -> представитель
+    std::unordered_set<Symbol> classRepresentatives_;
+    std::unordered_set<StateId> memberRuleStates_;
+    std::map<StateId, int> sourceLines_;                   // Первое состояние диапазона -> строка
 };
@@ -26,6 +26,17 @@ public:
     /** @brief Получить символ пустой ячейки */
     Symbol blank() const { return blank_; }
 
+    /** @brief Обойти непустые ячейки: fn(position, symbol) */
+    template <typename Fn>
+    void forEachCell(Fn&& fn) const {
+        for (const auto& kv : cells_) {
+            fn(kv.first, kv.second);
+        }
+    }
+
+    /** @brief Совпадают ли содержимое и пустой символ */
+    bool operator==(const Tape& other) const;
+
 private:
     Symbol blank_;
     std::unordered_map<long long, Symbol> cells_;
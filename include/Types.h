@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 /** @brief Идентификатор состояния машины Тьюринга */
 using StateId = int;
@@ -9,5 +11,25 @@ using StateId = int;
 /** @brief Символ алфавита ленты машины Тьюринга */
 using Symbol = std::string;
 
+/**
+ * @brief Невладеющий вид на непрерывную последовательность символов (как std::span)
+ *
+ * Источник (обычно std::vector<Symbol>) должен пережить вид.
+ */
+class SymbolSpan {
+public:
+    SymbolSpan() = default;
+    SymbolSpan(const std::vector<Symbol>& symbols) : data_(symbols.data()), size_(symbols.size()) {}
+
+    const Symbol* begin() const { return data_; }
+    const Symbol* end() const { return data_ + size_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    const Symbol* data_{nullptr};
+    std::size_t size_{0};
+};
+
 /** @brief Направление движения головки */
 enum class Move { Left, Right, Stay };
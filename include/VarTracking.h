@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+#include "IR.h"
+
+/** @brief Что сделал проход отслеживания x */
+struct VarTrackingStats {
+    std::size_t foldedConditions{0};   // Сравнения x, вычисленные при компиляции
+    std::size_t unrolledLoops{0};      // Циклы с известным числом итераций
+    std::size_t removedVarOps{0};      // Удалённые операции с x
+};
+
+/**
+ * @brief Отслеживание значения x по плоскому IR
+ *
+ * Абстрактная интерпретация: для каждой точки программы известно множество
+ * возможных значений x. Сравнения с однозначным результатом сворачиваются,
+ * циклы по x с известным значением разворачиваются (не больше unrollBudget
+ * инструкций), а операции с известным результатом не выполняются - значение
+ * записывается в память одним x = N только там, где его могут прочитать
+ * (сравнение, слияние веток, конец программы). Новые узлы выделяются в arena.
+ */
+VarTrackingStats trackVariable(IRBlock& instructions, IRArena& arena, std::size_t unrollBudget);
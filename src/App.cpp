@@ -12,6 +12,33 @@
 #include <SFML/Graphics/RectangleShape.hpp>
 #include <SFML/System/Clock.hpp>
 
+namespace {
+
+/** @brief Настройки компилятора редактора: результаты переживают перезапуск */
+CompileOptions editorCompileOptions() {
+    CompileOptions options;
+    options.diskCache.directory = "compile_cache";  // Рядом с preset.txt
+    return options;
+}
+
+// Пауза после последней правки до автоматической перекомпиляции, с
+constexpr float kAutoCompileDelay = 0.5f;
+
+/** @brief Название этапа для строки состояния */
+const char* compilePhaseLabel(CompilePhase phase) {
+    switch (phase) {
+    case CompilePhase::Queued: return "starting";
+    case CompilePhase::Parsing: return "parsing";
+    case CompilePhase::Flattening: return "inlining";
+    case CompilePhase::Optimizing: return "optimizing IR";
+    case CompilePhase::Codegen: return "generating";
+    case CompilePhase::TableOptimizing: return "optimizing table";
+    case CompilePhase::Done: return "done";
+    }
+    return "";
+}
+
+} // namespace
 
 App::App() {
     // Моноширинный шрифт Consolas
@@ -49,12 +76,18 @@ App::App() {
         editorLines_.push_back("");
     }
 
-    Compiler compiler;
-    lastCompile_ = compiler.compile(sourceCode_);
+    startCompile();
     tableScrollX_ = 0.f;
     firstVisibleTransitionRow_ = 0;
 }
 
+App::~App() {
+    if (compileProgress_) {
+        compileProgress_->cancel();
+        compileThread_.join();
+    }
+}
+
 
 App::Layout App::computeLayout(const sf::Vector2u& size) const {
     const float w = static_cast<float>(size.x);
@@ -227,7 +260,17 @@ void App::handleEvent(const sf::Event& event, sf::RenderWindow& window) {
 }
 
 
-void App::update(float) {
+void App::update(float dt) {
+    pollCompile();
+
+    // Автоматическая перекомпиляция после паузы в наборе
+    if (autoCompileDelay_ >= 0.f) {
+        autoCompileDelay_ -= dt;
+        if (autoCompileDelay_ < 0.f) {
+            requestCompile();
+        }
+    }
+
     if (mode_ == AppMode::Running) {
         requestStep();
     }
@@ -378,9 +421,10 @@ void App::renderTable(sf::RenderWindow& window, const Layout& layout) {
                 // Ячейка перехода
                 const std::size_t symIdx = col - 1;
                 const Symbol& sym = alphabet[symIdx];
+                Transition rule;
                 const Transition* tr = nullptr;
-                if (!states.empty()) {
-                    tr = lastCompile_.table.get(states[r], sym);
+                if (!states.empty() && lastCompile_.table.lookup(states[r], sym, rule)) {
+                    tr = &rule;
                 }
                 
                 // Состояние остановки - "halt"
@@ -757,8 +801,10 @@ std::vector<App::ControlButtonSpec> App::buildControlButtons(const Layout& layou
     const bool halted = (mode_ == AppMode::Halted);
     const bool canRunBase = hasValidTable() && !sourceDirty_;
 
+    const bool compiling = compileProgress_ && !compileProgress_->cancelled();
+
     // Кнопки
-    push("Compile", mode_ != AppMode::Running);                         // Компиляция (не во время выполнения)
+    push(compiling ? "Cancel" : "Compile", mode_ != AppMode::Running);  // Компиляция или её отмена (не во время выполнения)
     push("Reset", hasValidTable());                                     // Сброс (если есть таблица)
     push("Step", hasValidTable() && !running && !halted);               // Шаг (если не выполняется и не остановлено)
     push(running ? "Pause" : "Run", canRunBase || running || paused);   // Run/Pause
@@ -784,7 +830,11 @@ void App::handleControlClick(const sf::Vector2f& pos, const Layout& layout) {
 
         switch (i) {
         case 0:
-            requestCompile();
+            if (compileProgress_ && !compileProgress_->cancelled()) {
+                requestCancelCompile();
+            } else {
+                requestCompile();
+            }
             return;
         case 1:
             requestResetMachine();
@@ -980,12 +1030,37 @@ void App::renderControls(sf::RenderWindow& window, const Layout& layout) {
         modeStr += " (dirty)";
     }
 
+    // Идёт фоновая компиляция - этап и процент
+    const bool compiling = compileProgress_ && !compileProgress_->cancelled();
+    const float fraction = compiling ? compileProgress_->fraction() : 0.f;
+    if (compiling) {
+        modeStr += " | Compiling: ";
+        modeStr += compilePhaseLabel(compileProgress_->phase());
+        modeStr += " " + std::to_string(static_cast<int>(fraction * 100.f)) + "%";
+    }
+
     text.setString(modeStr);
     const auto bounds = text.getLocalBounds();
     const float statusX = layout.controls.pos.x + layout.controls.size.x - padding - bounds.size.x - bounds.position.x;
     const float statusY = layout.controls.pos.y + padding - bounds.position.y;
     text.setPosition({statusX, statusY});
     window.draw(text);
+
+    // Полоса хода этапа под строкой состояния
+    if (compiling) {
+        const sf::Vector2f barPos{statusX + bounds.position.x, statusY + bounds.position.y + bounds.size.y + 4.f};
+        sf::RectangleShape track;
+        track.setPosition(barPos);
+        track.setSize({bounds.size.x, 4.f});
+        track.setFillColor(sf::Color(40, 40, 50));
+        window.draw(track);
+
+        sf::RectangleShape bar;
+        bar.setPosition(barPos);
+        bar.setSize({bounds.size.x * fraction, 4.f});
+        bar.setFillColor(sf::Color(110, 170, 130));
+        window.draw(bar);
+    }
 }
 
 // renderEditor - Отрисовка текстового редактора
@@ -1161,13 +1236,66 @@ void App::renderEditor(sf::RenderWindow& window, const Layout& layout) {
 
 // requestCompile - Запрос компиляции исходного кода
 void App::requestCompile() {
+    autoCompileDelay_ = -1.f;
+    if (compileProgress_ && !compileProgress_->cancelled()) {
+        return;                                    // Текущий код уже компилируется
+    }
     if (!sourceDirty_ && lastCompile_.ok) {
         return;
     }
+    if (compileProgress_) {
+        autoCompileDelay_ = 0.f;                   // Отменённая компиляция ещё завершается - начнём после неё
+        return;
+    }
+    startCompile();
+}
 
-    Compiler compiler;
+// requestCancelCompile - Отмена фоновой компиляции
+void App::requestCancelCompile() {
+    autoCompileDelay_ = -1.f;
+    if (compileProgress_) {
+        compileProgress_->cancel();                // Поток завершится на ближайшей проверке, его заберёт pollCompile
+    }
+}
+
+// startCompile - Запуск компиляции в фоновом потоке
+void App::startCompile() {
     rebuildSourceFromLines();                      // Собираем код из строк
-    lastCompile_ = compiler.compile(sourceCode_);  // Компилируем
+    compileProgress_ = std::make_unique<CompileProgress>();
+    // Поток работает с копией кода и кэшем; lastCompile_ меняет только update()
+    compileThread_ = std::thread([this, source = sourceCode_, progress = compileProgress_.get()] {
+        Compiler compiler(editorCompileOptions());
+        CompileResult result = compiler.compile(source, compileCache_, *progress);  // Переиспользуя неизменённое
+        std::lock_guard<std::mutex> lock(compileMutex_);
+        finishedCompile_ = std::move(result);
+    });
+}
+
+// pollCompile - Проверка завершения фоновой компиляции
+void App::pollCompile() {
+    if (!compileProgress_) {
+        return;
+    }
+    std::optional<CompileResult> finished;
+    {
+        std::lock_guard<std::mutex> lock(compileMutex_);
+        finished.swap(finishedCompile_);
+    }
+    if (!finished) {
+        return;
+    }
+    compileThread_.join();
+    const bool cancelled = compileProgress_->cancelled();
+    compileProgress_.reset();
+    // Отменённая компиляция - код правили после её начала, результат устарел
+    if (!cancelled) {
+        applyCompileResult(std::move(*finished));
+    }
+}
+
+// applyCompileResult - Подмена текущего результата компиляции
+void App::applyCompileResult(CompileResult result) {
+    lastCompile_ = std::move(result);
     sourceDirty_ = false;                          // Код теперь соответствует скомпилированному
     tableScrollX_ = 0.f;                           // Сбрасываем скролл таблицы
     firstVisibleTransitionRow_ = 0;
@@ -1271,4 +1399,8 @@ bool App::hasValidTable() const {
 void App::markEdited() {
     sourceDirty_ = true;
     mode_ = AppMode::IdleEditing;
+    if (compileProgress_) {
+        compileProgress_->cancel();                // Компилируется уже устаревший код
+    }
+    autoCompileDelay_ = kAutoCompileDelay;         // Перекомпилировать, когда правки прекратятся
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "CodegenPrimitives.h"
 
 #include <cstdint>
+#include <utility>
 
 using namespace MemoryLayout;
 
@@ -15,34 +16,107 @@ void int8ToBits(int value, Symbol bits[8]) {
     }
 }
 
+// Маркеры позиции
 
-// Базовые генераторы переходов
+/** @brief Маркер с запомненным символом (#a, #blank) */
+static bool isSymbolMarker(const Symbol& sym) {
+    return sym.size() > kPosMarker.size() && sym.compare(0, kPosMarker.size(), kPosMarker) == 0;
+}
 
-StateId genMoveLeftAll(CodegenContext& ctx, StateId from, StateId to) {
+/** @brief Маркер, который ищет возврат: '#' в цепочке символа, #<символ> в общей цепочке */
+static bool isMarkerFor(const Symbol& sym, const Symbol& originalSym) {
+    return originalSym.empty() ? isSymbolMarker(sym) : sym == kPosMarker;
+}
+
+static Symbol restoredSymbol(const Symbol& marker, const Symbol& originalSym) {
+    if (!originalSym.empty()) {
+        return originalSym;
+    }
+    Symbol sym = marker.substr(kPosMarker.size());
+    return sym == "blank" ? Symbol(" ") : sym;
+}
+
+static bool isUserSymbol(const CodegenContext& ctx, const Symbol& sym) {
+    if (sym == kPosMarker || sym == kSymBOM || sym == kSymEOM ||
+        sym == kBit0 || sym == kBit1) {
+        return false;
+    }
+    return !(ctx.access.sharedMarkers && isSymbolMarker(sym));
+}
+
+/**
+ * @brief Ключи цепочек операции с переменной
+ *
+ * Без общих маркеров - по цепочке на каждый пользовательский символ, иначе
+ * одна цепочка с пустым ключом: символ запоминается в маркере #<символ>.
+ */
+static std::vector<Symbol> chainKeys(const CodegenContext& ctx) {
+    if (ctx.access.sharedMarkers) {
+        return {Symbol{}};
+    }
+    std::vector<Symbol> keys;
     for (const auto& sym : ctx.alphabet) {
-        ctx.tt->add(from, sym, {to, sym, Move::Left});
+        if (isUserSymbol(ctx, sym)) {
+            keys.push_back(sym);
+        }
     }
-    return to;
+    return keys;
 }
 
-StateId genMoveRightAll(CodegenContext& ctx, StateId from, StateId to) {
+/** @brief Заменить символ под головкой маркером и перейти в цепочку key */
+static void genPlaceMarker(CodegenContext& ctx, StateId entry, StateId chain, const Symbol& key) {
+    if (!key.empty()) {
+        ctx.tt->add(entry, key, {chain, kPosMarker, Move::Stay});
+        return;
+    }
     for (const auto& sym : ctx.alphabet) {
-        ctx.tt->add(from, sym, {to, sym, Move::Right});
+        if (isUserSymbol(ctx, sym)) {
+            ctx.tt->add(entry, sym, {chain, markerFor(sym), Move::Stay});
+        }
+    }
+    // Маркер запоминает сам символ, а не его класс
+    for (const auto& sym : ctx.classMembers) {
+        ctx.tt->add(entry, sym, {chain, markerFor(sym), Move::Stay});
     }
+}
+
+bool addMarkerSymbols(std::vector<Symbol>& alphabet) {
+    std::vector<Symbol> markers;
+    for (const auto& sym : alphabet) {
+        if (sym == kPosMarker || sym == kSymBOM || sym == kSymEOM ||
+            sym == kBit0 || sym == kBit1) {
+            continue;
+        }
+        // Пользовательский символ вида #... неотличим от маркера
+        if (isSymbolMarker(sym)) {
+            return false;
+        }
+        markers.push_back(markerFor(sym));
+    }
+    alphabet.insert(alphabet.end(), markers.begin(), markers.end());
+    return true;
+}
+
+
+// Базовые генераторы переходов
+
+StateId genMoveLeftAll(CodegenContext& ctx, StateId from, StateId to) {
+    ctx.tt->setDefault(from, {to, kKeepSymbol, Move::Left});
+    return to;
+}
+
+StateId genMoveRightAll(CodegenContext& ctx, StateId from, StateId to) {
+    ctx.tt->setDefault(from, {to, kKeepSymbol, Move::Right});
     return to;
 }
 
 StateId genStayAll(CodegenContext& ctx, StateId from, StateId to) {
-    for (const auto& sym : ctx.alphabet) {
-        ctx.tt->add(from, sym, {to, sym, Move::Stay});
-    }
+    ctx.tt->setDefault(from, {to, kKeepSymbol, Move::Stay});
     return to;
 }
 
 StateId genWriteConstAll(CodegenContext& ctx, StateId from, StateId to, const Symbol& w) {
-    for (const auto& sym : ctx.alphabet) {
-        ctx.tt->add(from, sym, {to, w, Move::Stay});
-    }
+    ctx.tt->setDefault(from, {to, w, Move::Stay});
     return to;
 }
 
@@ -187,11 +261,10 @@ StateId genReturnToMarker(CodegenContext& ctx, StateId entry, StateId exit, cons
         StateId searchMarker = afterEOM;
         
         for (const auto& sym : ctx.alphabet) {
-            if (sym == kPosMarker) {
-                ctx.tt->add(searchMarker, sym, {exit, originalSym, Move::Stay});
-            } else if (sym == " ") {
-                ctx.tt->add(searchMarker, sym, {exit, sym, Move::Stay});
+            if (isMarkerFor(sym, originalSym)) {
+                ctx.tt->add(searchMarker, sym, {exit, restoredSymbol(sym, originalSym), Move::Stay});
             } else {
+                // Пустые ячейки между памятью и маркером тоже проходим
                 ctx.tt->add(searchMarker, sym, {searchMarker, sym, Move::Right});
             }
         }
@@ -213,10 +286,8 @@ StateId genReturnToMarker(CodegenContext& ctx, StateId entry, StateId exit, cons
         StateId searchMarker = afterBOM;
         
         for (const auto& sym : ctx.alphabet) {
-            if (sym == kPosMarker) {
-                ctx.tt->add(searchMarker, sym, {exit, originalSym, Move::Stay});
-            } else if (sym == " ") {
-                ctx.tt->add(searchMarker, sym, {exit, sym, Move::Stay});
+            if (isMarkerFor(sym, originalSym)) {
+                ctx.tt->add(searchMarker, sym, {exit, restoredSymbol(sym, originalSym), Move::Stay});
             } else {
                 ctx.tt->add(searchMarker, sym, {searchMarker, sym, Move::Left});
             }
@@ -226,6 +297,205 @@ StateId genReturnToMarker(CodegenContext& ctx, StateId entry, StateId exit, cons
     return 3;
 }
 
+// Память рядом с головкой (Placement::FollowsHead)
+//
+// Головка на p, блок памяти на p-10..p-1: BOM, 8 бит (MSB..LSB), EOM.
+// Расстояние до переменной постоянно, поэтому маркер '#' и размножение
+// цепочек по символам алфавита не нужны, а возврат - это поиск EOM вправо.
+
+/** @brief Идти вправо до EOM и шагнуть на клетку за ним */
+static void genBackToHead(CodegenContext& ctx, StateId from, StateId exit) {
+    for (const auto& sym : ctx.alphabet) {
+        if (sym == kSymEOM) {
+            ctx.tt->add(from, sym, {exit, sym, Move::Right});
+        } else {
+            ctx.tt->add(from, sym, {from, sym, Move::Right});
+        }
+    }
+}
+
+/** @brief Шаг влево с головки и поиск BOM; выход на MSB */
+static void genGoToMSBAdjacent(CodegenContext& ctx, StateId entry, StateId onMSB) {
+    StateId scan = ctx.allocState();
+    genMoveLeftAll(ctx, entry, scan);
+    for (const auto& sym : ctx.alphabet) {
+        if (sym == kSymBOM) {
+            ctx.tt->add(scan, sym, {onMSB, sym, Move::Right});
+        } else {
+            ctx.tt->add(scan, sym, {scan, sym, Move::Left});
+        }
+    }
+}
+
+static StateId genSetInt8ConstAdjacent(CodegenContext& ctx, StateId entry, StateId exit, int value) {
+    Symbol bits[8];
+    int8ToBits(value, bits);
+
+    StateId current = ctx.allocState();
+    genGoToMSBAdjacent(ctx, entry, current);
+
+    // Пишем биты от MSB к LSB, после LSB стоим на EOM
+    for (int i = 0; i < kMemBits; i++) {
+        StateId next = ctx.allocState();
+        ctx.tt->setDefault(current, {next, bits[i], Move::Right});
+        current = next;
+    }
+    genMoveRightAll(ctx, current, exit);
+
+    return 2 + kMemBits + 1;
+}
+
+/** @brief x++ / x--: перенос (заём) от LSB к MSB, затем обратно к головке */
+static StateId genAddInt8Adjacent(CodegenContext& ctx, StateId entry, StateId exit, bool increment) {
+    const Symbol& keep = increment ? kBit0 : kBit1;   // Бит, на котором перенос заканчивается
+    const Symbol& flip = increment ? kBit1 : kBit0;
+
+    StateId onEOM = ctx.allocState();
+    StateId carry = ctx.allocState();
+    StateId back = ctx.allocState();
+
+    genMoveLeftAll(ctx, entry, onEOM);
+    genMoveLeftAll(ctx, onEOM, carry);
+
+    for (const auto& sym : ctx.alphabet) {
+        if (sym == keep) {
+            ctx.tt->add(carry, sym, {back, flip, Move::Right});
+        } else if (sym == flip) {
+            ctx.tt->add(carry, sym, {carry, keep, Move::Left});
+        } else {
+            // BOM - переполнение, остальные символы здесь не встречаются
+            ctx.tt->add(carry, sym, {back, sym, Move::Right});
+        }
+    }
+    genBackToHead(ctx, back, exit);
+
+    return 4;
+}
+
+/** @brief Сравнение x < rhs (less) или x > rhs по битам от MSB */
+static StateId genCmpInt8ConstAdjacent(CodegenContext& ctx, StateId entry,
+                                       StateId ifTrue, StateId ifFalse, int rhs, bool less) {
+    Symbol rhsBits[8];
+    int8ToBits(rhs, rhsBits);
+
+    StateId backTrue = ctx.allocState();
+    StateId backFalse = ctx.allocState();
+    genBackToHead(ctx, backTrue, ifTrue);
+    genBackToHead(ctx, backFalse, ifFalse);
+
+    StateId current = ctx.allocState();
+    genGoToMSBAdjacent(ctx, entry, current);
+
+    for (int i = 0; i < kMemBits; i++) {
+        StateId next = (i < kMemBits - 1) ? ctx.allocState() : backFalse;
+        for (const auto& sym : ctx.alphabet) {
+            if (sym != kBit0 && sym != kBit1) {
+                ctx.tt->add(current, sym, {backFalse, sym, Move::Right});
+                continue;
+            }
+            const bool xBit = (sym == kBit1);
+            const bool rBit = (rhsBits[i] == kBit1);
+            if (xBit == rBit) {
+                // Биты равны: дальше (равенство до конца - false)
+                ctx.tt->add(current, sym, {next, sym, Move::Right});
+            } else {
+                // Знаковый бит сравнивается наоборот
+                bool xGreater = (i == 0) ? !xBit : xBit;
+                bool result = less ? !xGreater : xGreater;
+                ctx.tt->add(current, sym, {result ? backTrue : backFalse, sym, Move::Right});
+            }
+        }
+        current = next;
+    }
+
+    return 3 + kMemBits + 1;
+}
+
+StateId genShiftMemoryRight(CodegenContext& ctx, StateId entry, StateId exit) {
+    // Символ из-под головки переносим на место BOM, а блок памяти
+    // переписываем на клетку правее: BOM, биты и EOM "едут" за головкой.
+    StateId shiftBOM = ctx.allocState();
+    StateId carry0 = ctx.allocState();
+    StateId carry1 = ctx.allocState();
+    StateId carryEOM = ctx.allocState();
+
+    for (const auto& u : ctx.alphabet) {
+        if (u == kSymBOM || u == kSymEOM) {
+            ctx.tt->add(entry, u, {exit, u, Move::Stay});
+            continue;
+        }
+        StateId carryU = ctx.allocState();
+        ctx.tt->add(entry, u, {carryU, u, Move::Left});
+        for (const auto& sym : ctx.alphabet) {
+            if (sym == kSymBOM) {
+                ctx.tt->add(carryU, sym, {shiftBOM, u, Move::Right});
+            } else {
+                ctx.tt->add(carryU, sym, {carryU, sym, Move::Left});
+            }
+        }
+    }
+
+    // Каждое состояние carry* пишет то, что было в клетке левее
+    const std::pair<StateId, Symbol> carries[] = {
+        {shiftBOM, kSymBOM}, {carry0, kBit0}, {carry1, kBit1}};
+    for (const auto& [state, carried] : carries) {
+        for (const auto& sym : ctx.alphabet) {
+            if (sym == kBit0) {
+                ctx.tt->add(state, sym, {carry0, carried, Move::Right});
+            } else if (sym == kBit1) {
+                ctx.tt->add(state, sym, {carry1, carried, Move::Right});
+            } else if (sym == kSymEOM) {
+                ctx.tt->add(state, sym, {carryEOM, carried, Move::Right});
+            }
+        }
+    }
+
+    // Старая клетка головки становится EOM, головка - на следующей
+    ctx.tt->setDefault(carryEOM, {exit, kSymEOM, Move::Right});
+
+    return countShiftMemoryRightStates(ctx.alphabet);
+}
+
+StateId genShiftMemoryLeft(CodegenContext& ctx, StateId entry, StateId exit) {
+    // Блок памяти переписываем на клетку левее (справа налево), а символ,
+    // стоявший перед BOM, переносим на место старого EOM - новую клетку головки.
+    StateId onEOM = ctx.allocState();
+    StateId carryEOM = ctx.allocState();
+    StateId carry0 = ctx.allocState();
+    StateId carry1 = ctx.allocState();
+    StateId carryBOM = ctx.allocState();
+
+    genMoveLeftAll(ctx, entry, onEOM);
+    genMoveLeftAll(ctx, onEOM, carryEOM);
+
+    const std::pair<StateId, Symbol> carries[] = {
+        {carryEOM, kSymEOM}, {carry0, kBit0}, {carry1, kBit1}};
+    for (const auto& [state, carried] : carries) {
+        for (const auto& sym : ctx.alphabet) {
+            if (sym == kBit0) {
+                ctx.tt->add(state, sym, {carry0, carried, Move::Left});
+            } else if (sym == kBit1) {
+                ctx.tt->add(state, sym, {carry1, carried, Move::Left});
+            } else if (sym == kSymBOM) {
+                ctx.tt->add(state, sym, {carryBOM, carried, Move::Left});
+            }
+        }
+    }
+
+    for (const auto& u : ctx.alphabet) {
+        if (u == kSymBOM || u == kSymEOM) {
+            continue;
+        }
+        StateId carryU = ctx.allocState();
+        StateId putU = ctx.allocState();
+        ctx.tt->add(carryBOM, u, {carryU, kSymBOM, Move::Right});
+        genBackToHead(ctx, carryU, putU);
+        genWriteConstAll(ctx, putU, exit, u);
+    }
+
+    return countShiftMemoryLeftStates(ctx.alphabet);
+}
+
 // Операции с 8-битной переменной
 
 /**
@@ -241,20 +511,18 @@ StateId genReturnToMarker(CodegenContext& ctx, StateId entry, StateId exit, cons
  */
 
 StateId genSetInt8Const(CodegenContext& ctx, StateId entry, StateId exit, int value) {
+    if (ctx.access.memoryFollowsHead) {
+        return genSetInt8ConstAdjacent(ctx, entry, exit, value);
+    }
+
     Symbol bits[8];
     int8ToBits(value, bits);
     
-    std::vector<Symbol> userSymbols;
-    for (const auto& sym : ctx.alphabet) {
-        if (sym != kPosMarker && sym != kSymBOM && sym != kSymEOM && 
-            sym != kBit0 && sym != kBit1) {
-            userSymbols.push_back(sym);
-        }
-    }
+    const std::vector<Symbol> chains = chainKeys(ctx);
     
-    for (const auto& origSym : userSymbols) {
+    for (const auto& origSym : chains) {
         StateId afterMarker = ctx.allocState();
-        ctx.tt->add(entry, origSym, {afterMarker, kPosMarker, Move::Stay});
+        genPlaceMarker(ctx, entry, afterMarker, origSym);
         
         StateId goToMem = afterMarker;
         StateId afterBOM = ctx.allocState();
@@ -292,23 +560,21 @@ StateId genSetInt8Const(CodegenContext& ctx, StateId entry, StateId exit, int va
         }
     }
     
-    return userSymbols.size() * (1 + 1 + kMemBits * 2 + 3);
+    return chains.size() * (1 + 1 + kMemBits * 2 + 3);
 }
 
 StateId genIncInt8(CodegenContext& ctx, StateId entry, StateId exit) {
+    if (ctx.access.memoryFollowsHead) {
+        return genAddInt8Adjacent(ctx, entry, exit, true);
+    }
+
     // Инкремент x++ (инкрементируем от LSB к MSB)
     
-    std::vector<Symbol> userSymbols;
-    for (const auto& sym : ctx.alphabet) {
-        if (sym != kPosMarker && sym != kSymBOM && sym != kSymEOM && 
-            sym != kBit0 && sym != kBit1) {
-            userSymbols.push_back(sym);
-        }
-    }
+    const std::vector<Symbol> chains = chainKeys(ctx);
     
-    for (const auto& origSym : userSymbols) {
+    for (const auto& origSym : chains) {
         StateId afterMarker = ctx.allocState();
-        ctx.tt->add(entry, origSym, {afterMarker, kPosMarker, Move::Stay});
+        genPlaceMarker(ctx, entry, afterMarker, origSym);
         
         StateId returnState = ctx.allocState();
         genReturnToMarker(ctx, returnState, exit, origSym);
@@ -350,9 +616,7 @@ StateId genIncInt8(CodegenContext& ctx, StateId entry, StateId exit) {
             }
         }
         
-        for (const auto& sym : ctx.alphabet) {
-            ctx.tt->add(afterWrite0, sym, {checkBit, sym, carryDir});
-        }
+        ctx.tt->setDefault(afterWrite0, {checkBit, kKeepSymbol, carryDir});
     }
     
     // Системные символы
@@ -363,24 +627,22 @@ StateId genIncInt8(CodegenContext& ctx, StateId entry, StateId exit) {
         }
     }
     
-    return userSymbols.size() * 8;
+    return chains.size() * 8;
 }
 
 StateId genDecInt8(CodegenContext& ctx, StateId entry, StateId exit) {
+    if (ctx.access.memoryFollowsHead) {
+        return genAddInt8Adjacent(ctx, entry, exit, false);
+    }
+
     // Декремент x--
     // То же что и ++, но наоборот
     
-    std::vector<Symbol> userSymbols;
-    for (const auto& sym : ctx.alphabet) {
-        if (sym != kPosMarker && sym != kSymBOM && sym != kSymEOM && 
-            sym != kBit0 && sym != kBit1) {
-            userSymbols.push_back(sym);
-        }
-    }
+    const std::vector<Symbol> chains = chainKeys(ctx);
     
-    for (const auto& origSym : userSymbols) {
+    for (const auto& origSym : chains) {
         StateId afterMarker = ctx.allocState();
-        ctx.tt->add(entry, origSym, {afterMarker, kPosMarker, Move::Stay});
+        genPlaceMarker(ctx, entry, afterMarker, origSym);
         
         StateId returnState = ctx.allocState();
         genReturnToMarker(ctx, returnState, exit, origSym);
@@ -421,9 +683,7 @@ StateId genDecInt8(CodegenContext& ctx, StateId entry, StateId exit) {
             }
         }
         
-        for (const auto& sym : ctx.alphabet) {
-            ctx.tt->add(afterWrite1, sym, {checkBit, sym, borrowDir});
-        }
+        ctx.tt->setDefault(afterWrite1, {checkBit, kKeepSymbol, borrowDir});
     }
     
     for (const auto& sym : ctx.alphabet) {
@@ -433,11 +693,15 @@ StateId genDecInt8(CodegenContext& ctx, StateId entry, StateId exit) {
         }
     }
     
-    return userSymbols.size() * 8;
+    return chains.size() * 8;
 }
 
 StateId genCmpInt8Const_LT(CodegenContext& ctx, StateId entry, 
                            StateId ifTrue, StateId ifFalse, int rhs) {
+    if (ctx.access.memoryFollowsHead) {
+        return genCmpInt8ConstAdjacent(ctx, entry, ifTrue, ifFalse, rhs, true);
+    }
+
     // Сравнение x < rhs
     
     Symbol rhsBits[8];
@@ -445,17 +709,11 @@ StateId genCmpInt8Const_LT(CodegenContext& ctx, StateId entry,
     
     bool rhsNegative = (rhs < 0);
     
-    std::vector<Symbol> userSymbols;
-    for (const auto& sym : ctx.alphabet) {
-        if (sym != kPosMarker && sym != kSymBOM && sym != kSymEOM && 
-            sym != kBit0 && sym != kBit1) {
-            userSymbols.push_back(sym);
-        }
-    }
+    const std::vector<Symbol> chains = chainKeys(ctx);
     
-    for (const auto& origSym : userSymbols) {
+    for (const auto& origSym : chains) {
         StateId afterMarker = ctx.allocState();
-        ctx.tt->add(entry, origSym, {afterMarker, kPosMarker, Move::Stay});
+        genPlaceMarker(ctx, entry, afterMarker, origSym);
         
         StateId returnThenTrue = ctx.allocState();
         StateId returnThenFalse = ctx.allocState();
@@ -552,6 +810,10 @@ StateId genCmpInt8Const_LT(CodegenContext& ctx, StateId entry,
 
 StateId genCmpInt8Const_GT(CodegenContext& ctx, StateId entry, 
                            StateId ifTrue, StateId ifFalse, int rhs) {
+    if (ctx.access.memoryFollowsHead) {
+        return genCmpInt8ConstAdjacent(ctx, entry, ifTrue, ifFalse, rhs, false);
+    }
+
     // Сравнение x > rhs
     // Аналогично LT, но реверснуто
 
@@ -560,17 +822,11 @@ StateId genCmpInt8Const_GT(CodegenContext& ctx, StateId entry,
     
     bool rhsNegative = (rhs < 0);
     
-    std::vector<Symbol> userSymbols;
-    for (const auto& sym : ctx.alphabet) {
-        if (sym != kPosMarker && sym != kSymBOM && sym != kSymEOM && 
-            sym != kBit0 && sym != kBit1) {
-            userSymbols.push_back(sym);
-        }
-    }
+    const std::vector<Symbol> chains = chainKeys(ctx);
     
-    for (const auto& origSym : userSymbols) {
+    for (const auto& origSym : chains) {
         StateId afterMarker = ctx.allocState();
-        ctx.tt->add(entry, origSym, {afterMarker, kPosMarker, Move::Stay});
+        genPlaceMarker(ctx, entry, afterMarker, origSym);
         
         StateId returnThenTrue = ctx.allocState();
         StateId returnThenFalse = ctx.allocState();
@@ -674,31 +930,61 @@ static size_t countUserSymbols(const std::vector<Symbol>& alphabet) {
     return count;
 }
 
-StateId countVarSetConstStates(const std::vector<Symbol>& alphabet) {
+// Цепочек на операцию: одна при общих маркерах, иначе по символу
+static size_t countChains(const std::vector<Symbol>& alphabet, const VarAccess& access) {
+    return access.sharedMarkers ? 1 : countUserSymbols(alphabet);
+}
+
+StateId countVarSetConstStates(const std::vector<Symbol>& alphabet, const VarAccess& access) {
+    if (access.memoryFollowsHead) {
+        // entry + scan + 8 записей + шаг на головку
+        return 2 + kMemBits + 1;
+    }
     // Для каждого пользовательского символа делаем полную цепочку - идея с #.
     // Лучше перебрать с запасом, чем недобрать.
-    size_t userSyms = countUserSymbols(alphabet);
+    size_t userSyms = countChains(alphabet, access);
     // afterMarker + genGoToBOM(1) + 8*(onBit + afterWrite) + genReturnToMarker (2)
     // ИТОГО: 1 + 1 + 16 + 2 = 20 на символ, берём 30 для запаса - некоторые просто не юзаем
     return static_cast<StateId>(userSyms * 30);
 }
 
-StateId countVarIncStates(const std::vector<Symbol>& alphabet) {
-    size_t userSyms = countUserSymbols(alphabet);
+StateId countVarIncStates(const std::vector<Symbol>& alphabet, const VarAccess& access) {
+    if (access.memoryFollowsHead) {
+        // entry + onEOM + carry + back
+        return 4;
+    }
+    size_t userSyms = countChains(alphabet, access);
     // afterMarker + genGoToEOM(1) + onLSB + returnState + afterWrite0 + genReturnToMarker(2)
     // ИТОГО: 7, берём 15 для запаса
     return static_cast<StateId>(userSyms * 15);
 }
 
-StateId countVarDecStates(const std::vector<Symbol>& alphabet) {
-    size_t userSyms = countUserSymbols(alphabet);
+StateId countVarDecStates(const std::vector<Symbol>& alphabet, const VarAccess& access) {
+    if (access.memoryFollowsHead) {
+        return 4;
+    }
+    size_t userSyms = countChains(alphabet, access);
     return static_cast<StateId>(userSyms * 15);
 }
 
-StateId countCmpInt8States(const std::vector<Symbol>& alphabet, int /*rhs*/) {
-    size_t userSyms = countUserSymbols(alphabet);
+StateId countCmpInt8States(const std::vector<Symbol>& alphabet, int /*rhs*/, const VarAccess& access) {
+    if (access.memoryFollowsHead) {
+        // entry + scan + backTrue + backFalse + 8 сравнений
+        return 4 + kMemBits;
+    }
+    size_t userSyms = countChains(alphabet, access);
     // afterMarker + genGoToBOM(1) + onMSB + returnThenTrue + returnThenFalse 
     // + compareRest + 6 nextCompare + 2*genReturnToMarker(2)
     // ИТОГО: 16, берём 25 для запаса
     return static_cast<StateId>(userSyms * 25);
 }
+
+StateId countShiftMemoryRightStates(SymbolSpan alphabet) {
+    // entry + shiftBOM + carry0 + carry1 + carryEOM + перенос каждого символа кроме BOM/EOM
+    return static_cast<StateId>(5 + alphabet.size() - 2);
+}
+
+StateId countShiftMemoryLeftStates(SymbolSpan alphabet) {
+    // entry + onEOM + carryEOM + carry0 + carry1 + carryBOM + (перенос + запись) на символ
+    return static_cast<StateId>(6 + 2 * (alphabet.size() - 2));
+}
@@ -0,0 +1,80 @@
+#include "CompileCache.h"
+
+#include <functional>
+#include <utility>
+
+namespace {
+
+/** @brief Сдвинуть позиции узлов тела, начинавшегося на firstLine */
+template <typename Node>
+void shiftPositions(NodePool<Node>& pool, int firstLine, int lineDelta, int columnDelta) {
+    pool.forEach([&](Node& node) {
+        // Колонки меняются только на строке с 'proc': остальные строки тела те же
+        if (node.line == firstLine) {
+            node.column += columnDelta;
+        }
+        node.line += lineDelta;
+    });
+}
+
+} // namespace
+
+CachedProcedure* CompileCache::findProcedure(std::string_view text, int line, int column) {
+    auto it = procedures_.find(std::hash<std::string_view>{}(text));
+    if (it == procedures_.end()) return nullptr;
+
+    CachedProcedure& entry = *it->second;
+    if (entry.text != text || entry.used) {
+        return nullptr;
+    }
+
+    Procedure& procedure = entry.procedure;
+    const int lineDelta = line - procedure.line;
+    const int columnDelta = column - procedure.column;
+    if (lineDelta != 0 || columnDelta != 0) {
+        // program прошлой компиляции делит эти узлы, но её строки сохранены в programLines
+        shiftPositions(entry.arena->instructions, procedure.line, lineDelta, columnDelta);
+        shiftPositions(entry.arena->conditions, procedure.line, lineDelta, columnDelta);
+        procedure.line = line;
+        procedure.column = column;
+    }
+    return &entry;
+}
+
+void CompileCache::storeProcedure(std::unique_ptr<CachedProcedure> entry) {
+    auto& slot = procedures_[std::hash<std::string_view>{}(entry->text)];
+    if (slot) {
+        retired_.push_back(std::move(slot));
+    }
+    slot = std::move(entry);
+}
+
+void CompileCache::useAlphabet(const std::vector<Symbol>& alphabet) {
+    if (alphabet == alphabet_) return;
+    for (auto& [hash, entry] : procedures_) {
+        retired_.push_back(std::move(entry));
+    }
+    procedures_.clear();
+    alphabet_ = alphabet;
+}
+
+void CompileCache::beginCompile() {
+    reusedProcedures = 0;
+    parsedProcedures = 0;
+    reusedTable = false;
+    for (auto& [hash, entry] : procedures_) {
+        entry->used = false;
+    }
+}
+
+void CompileCache::endCompile() {
+    // program уже от этой компиляции и ссылается только на использованные записи
+    for (auto it = procedures_.begin(); it != procedures_.end();) {
+        if (it->second->used) {
+            ++it;
+        } else {
+            it = procedures_.erase(it);
+        }
+    }
+    retired_.clear();
+}
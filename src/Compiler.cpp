@@ -1,1321 +1,169 @@
 #include "Compiler.h"
+#include "CodegenPrimitives.h"
+#include "CompileCache.h"
+#include "DiskCache.h"
 #include "Condition.h"
 #include "Flatten.h"
 #include "IR.h"
-#include "Lexer.h"
+#include "IRAnalysis.h"
+#include "IRPasses.h"
 #include "MemoryLayout.h"
+#include "Parser.h"
+#include "TableOptimizer.h"
 #include "TransitionGenerator.h"
+#include "VarTracking.h"
 
 #include <algorithm>
-#include <cctype>
 #include <memory>
-#include <sstream>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 
-static std::vector<std::string> splitBySpaces(const std::string& str) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(str);
-    std::string tok;
-    while (iss >> tok) {
-        tokens.push_back(tok);
-    }
-    return tokens;
-}
+// flatten and transition generation moved to dedicated modules
 
-/**
- * @brief Проверяет, является ли символ зарезервированным системным символом.
- * Зарезервированы: blank, BOM, EOM, 0_, 1_, #
- */
-static bool isReservedSystemSymbol(const std::string& sym) {
-    return sym == "blank" ||
-           sym == MemoryLayout::kSymBOM ||
-           sym == MemoryLayout::kSymEOM ||
-           sym == MemoryLayout::kBit0 ||
-           sym == MemoryLayout::kBit1 ||
-           sym == MemoryLayout::kPosMarker;
+namespace {
+
+// Версия результата компиляции для кэша на диске: увеличивать при любом
+// изменении парсера, проходов или кодогенерации, меняющем таблицу или диагностику
+constexpr int kCompilerVersion = 2;
+
+/** @brief Версия и настройки, от которых зависит результат (parallelPhases и сам кэш - нет) */
+std::string compilerFingerprint(const CompileOptions& options) {
+    std::string fp = "tm-compiler " + std::to_string(kCompilerVersion) + ";";
+    auto flag = [&fp](bool value) { fp += value ? '1' : '0'; };
+
+    flag(options.foldStayTransitions);
+    flag(options.pruneImpossibleRules);
+    flag(options.trackVariable);
+    fp += ";" + std::to_string(options.unrollBudget) + ";";
+
+    const IRPassOptions& ir = options.irPasses;
+    flag(ir.constantConditions);
+    flag(ir.identicalBranches);
+    flag(ir.emptyIfs);
+    flag(ir.movePairs);
+    flag(ir.overwrittenWrites);
+    fp += ";";
+
+    const CodegenOptions& cg = options.codegen;
+    flag(cg.mergeBoundaryChecks);
+    flag(cg.elideUnreachablePhase);
+    flag(cg.sharedMarkerChains);
+    flag(cg.compileReadConditions);
+    flag(cg.lowerScanLoops);
+    flag(cg.dispatchElseIfChains);
+    flag(cg.shareIdenticalTails);
+    flag(cg.symbolClasses);
+    fp += ";" + std::to_string(static_cast<int>(cg.memoryPlacement));
+    return fp;
 }
 
-// flatten and transition generation moved to dedicated modules
+bool isCancelled(const CompileProgress* progress) {
+    return progress && progress->cancelled();
+}
 
-CompileResult Compiler::compile(std::string_view source) const {
+/** @brief Результат отменённой компиляции: частичная таблица и диагностика отбрасываются */
+CompileResult cancelledResult() {
     CompileResult result;
-    result.ok = true;
-
-    const Symbol blankSymbol = " ";
-    std::unordered_set<Symbol> alphabetSet;
-    alphabetSet.insert(blankSymbol);
-    result.alphabet.push_back(blankSymbol);
-
-    bool alphabetDefined = false;
-    bool setupDefined = false;
-
-    std::unordered_map<std::string, Procedure> procedures;
-    Procedure* currentProc = nullptr;
-
-    Lexer lexer(source);
-    Token token = lexer.next();
-
-    auto error = [&](int line, int col, const std::string& msg) {
-        result.ok = false;
-        result.diagnostics.push_back({DiagnosticLevel::Error, line, col, msg});
-    };
-
-    auto expect = [&](TokenType expected, const std::string& what) -> bool {
-        if (token.type != expected) {
-            error(token.line, token.column, "Ожидался " + what);
-            return false;
-        }
-        return true;
-    };
-
-    auto addInstruction = [&](std::shared_ptr<IRInstruction> instr) {
-        if (!currentProc) {
-            error(instr->line, instr->column, "Инструкция вне процедуры");
-            return false;
-        }
-        currentProc->body.push_back(instr);
-        return true;
-    };
-
-    while (token.type != TokenType::Eof && result.ok) {
-        if (token.type == TokenType::Identifier) {
-            const std::string& cmd = token.value;
-            const int cmdLine = token.line;
-            const int cmdCol = token.column;
-
-            if (cmd == "Set_alphabet") {
-                if (currentProc) {
-                    error(cmdLine, cmdCol, "Set_alphabet не может быть внутри процедуры");
-                    break;
-                }
-                if (setupDefined) {
-                    error(cmdLine, cmdCol, "Set_alphabet должен быть перед Setup");
-                    break;
-                }
-                if (alphabetDefined) {
-                    error(cmdLine, cmdCol, "Set_alphabet уже был определён (повторный вызов запрещён)");
-                    break;
-                }
-                if (!procedures.empty()) {
-                    error(cmdLine, cmdCol, "Set_alphabet должен быть перед определением процедур");
-                    break;
-                }
-
-                // Парсим аргумент - строку с символами алфавита
-                token = lexer.next();
-                if (!expect(TokenType::StringLiteral, "строка с алфавитом")) break;
-
-                const std::string content = token.value;
-                const int strLine = token.line;
-                const int strCol = token.column;
-
-                token = lexer.next();
-                if (!expect(TokenType::Semicolon, ";")) break;
-
-                // Разбиваем строку по пробелам и добавляем символы в алфавит
-                auto symbols = splitBySpaces(content);
-                for (const auto& sym : symbols) {
-                    // Проверка на зарезервированные системные символы
-                    if (isReservedSystemSymbol(sym)) {
-                        error(strLine, strCol, "Имя '" + sym + "' зарезервировано и не может использоваться в алфавите");
-                        break;
-                    }
-                    // Проверка на дубликаты
-                    if (alphabetSet.count(sym)) {
-                        error(strLine, strCol, "Дублирующийся символ в алфавите: '" + sym + "'");
-                        break;
-                    }
-                    alphabetSet.insert(sym);
-                    result.alphabet.push_back(sym);
-                }
-
-                alphabetDefined = true;
-                
-                // Добавляем системные символы в alphabetSet И result.alphabet сразу после парсинга алфавита,
-                // чтобы write "0_"/"1_" работало и символы отображались в таблице переходов
-                auto addSystemSymbol = [&](const Symbol& sym) {
-                    if (!alphabetSet.count(sym)) {
-                        alphabetSet.insert(sym);
-                        result.alphabet.push_back(sym);
-                    }
-                };
-                addSystemSymbol(MemoryLayout::kSymBOM);
-                addSystemSymbol(MemoryLayout::kSymEOM);
-                addSystemSymbol(MemoryLayout::kBit0);
-                addSystemSymbol(MemoryLayout::kBit1);
-                addSystemSymbol(MemoryLayout::kPosMarker);
-                
-                token = lexer.next();
-
-            // Setup "содержимое ленты"; - начальное содержимое ленты
-            } else if (cmd == "Setup") {
-                if (currentProc) {
-                    error(cmdLine, cmdCol, "Setup не может быть внутри процедуры");
-                    break;
-                }
-                if (!alphabetDefined) {
-                    error(cmdLine, cmdCol, "Setup должен быть после Set_alphabet");
-                    break;
-                }
-                if (setupDefined) {
-                    error(cmdLine, cmdCol, "Setup уже был определён (повторный вызов запрещён)");
-                    break;
-                }
-                if (!procedures.empty()) {
-                    error(cmdLine, cmdCol, "Setup должен быть перед определением процедур");
-                    break;
-                }
-
-                token = lexer.next();
-                if (!expect(TokenType::StringLiteral, "строка с начальным содержимым ленты")) break;
-
-                const std::string content = token.value;
-                const int strLine = token.line;
-                const int strCol = token.column;
-
-                token = lexer.next();
-                if (!expect(TokenType::Semicolon, ";")) break;
-
-                auto symbols = splitBySpaces(content);
-                long long pos = 0;
-                for (const auto& sym : symbols) {
-                    Symbol actualSym = (sym == "blank") ? blankSymbol : sym;
-                    if (actualSym != blankSymbol && !alphabetSet.count(actualSym)) {
-                        error(strLine, strCol, "Символ '" + sym + "' не определён в алфавите");
-                        break;
-                    }
-                    result.initialTape.set(pos, actualSym);
-                    pos++;
-                }
-
-                setupDefined = true;
-                token = lexer.next();
-
-            // proc имя() { ... } - определение процедуры
-            } else if (cmd == "proc") {
-                // Проверка: нельзя определять процедуру внутри другой
-                if (currentProc) {
-                    error(cmdLine, cmdCol, "Вложенные процедуры не поддерживаются");
-                    break;
-                }
-                // Проверка: алфавит должен быть уже определён
-                if (!alphabetDefined) {
-                    error(cmdLine, cmdCol, "proc: сначала нужно определить Set_alphabet");
-                    break;
-                }
-
-                // Парсим имя процедуры
-                token = lexer.next();
-                if (!expect(TokenType::Identifier, "имя процедуры")) break;
-
-                const std::string procName = token.value;
-                const int nameL = token.line;
-                const int nameC = token.column;
-
-                // Проверка на дубликаты имён
-                if (procedures.count(procName)) {
-                    error(nameL, nameC, "Процедура '" + procName + "' уже определена");
-                    break;
-                }
-
-                // Парсим синтаксис: ()  {
-                token = lexer.next();
-                if (!expect(TokenType::LParen, "(")) break;
-                token = lexer.next();
-                if (!expect(TokenType::RParen, ")")) break;
-                token = lexer.next();
-                if (!expect(TokenType::LBrace, "{")) break;
-
-                // Создаём новую процедуру и устанавливаем её как текущую
-                Procedure proc;
-                proc.name = procName;
-                proc.line = cmdLine;
-                proc.column = cmdCol;
-
-                procedures[procName] = proc;
-                currentProc = &procedures[procName];
-                token = lexer.next();
-
-            // move_left; - перемещение головки влево
-            } else if (cmd == "move_left") {
-                if (!alphabetDefined) {
-                    error(cmdLine, cmdCol, "move_left: сначала нужно определить Set_alphabet");
-                    break;
-                }
-
-                token = lexer.next();
-                if (!expect(TokenType::Semicolon, ";")) break;
-
-                if (!addInstruction(IRInstruction::simple(IRType::MoveLeft, "", cmdLine, cmdCol))) break;
-                token = lexer.next();
-
-            // move_right; - перемещение головки вправо
-            } else if (cmd == "move_right") {
-                if (!alphabetDefined) {
-                    error(cmdLine, cmdCol, "move_right: сначала нужно определить Set_alphabet");
-                    break;
-                }
-
-                token = lexer.next();
-                if (!expect(TokenType::Semicolon, ";")) break;
-
-                if (!addInstruction(IRInstruction::simple(IRType::MoveRight, "", cmdLine, cmdCol))) break;
-                token = lexer.next();
-
-            // write "символ"; - запись символа на ленту
-            } else if (cmd == "write") {
-                if (!alphabetDefined) {
-                    error(cmdLine, cmdCol, "write: сначала нужно определить Set_alphabet");
-                    break;
-                }
-
-                token = lexer.next();
-                if (!expect(TokenType::StringLiteral, "символ для записи")) break;
-
-                const std::string symStr = token.value;
-                const int strLine = token.line;
-                const int strCol = token.column;
-
-                Symbol actualSym = (symStr == "blank") ? blankSymbol : symStr;
-                if (actualSym != blankSymbol && !alphabetSet.count(actualSym)) {
-                    error(strLine, strCol, "Символ '" + symStr + "' не определён в алфавите");
-                    break;
-                }
-
-                token = lexer.next();
-                if (!expect(TokenType::Semicolon, ";")) break;
-
-                if (!addInstruction(IRInstruction::simple(IRType::Write, actualSym, cmdLine, cmdCol))) break;
-                token = lexer.next();
-
-            // call имя; - вызов процедуры
-            } else if (cmd == "call") {
-                if (!alphabetDefined) {
-                    error(cmdLine, cmdCol, "call: сначала нужно определить Set_alphabet");
-                    break;
-                }
-
-                token = lexer.next();
-                if (!expect(TokenType::Identifier, "имя процедуры")) break;
-
-                const std::string procName = token.value;
-                const int nameL = token.line;
-                const int nameC = token.column;
-
-                if (!procedures.count(procName)) {
-                    error(nameL, nameC, "Процедура '" + procName + "' не определена");
-                    break;
-                }
-
-                token = lexer.next();
-                if (!expect(TokenType::Semicolon, ";")) break;
-
-                if (!addInstruction(IRInstruction::simple(IRType::Call, procName, cmdLine, cmdCol))) break;
-                token = lexer.next();
-
-            // if (условие) { ... } [else { ... }] - условная конструкция
-            } else if (cmd == "if") {
-                if (!alphabetDefined) {
-                    error(cmdLine, cmdCol, "if: сначала нужно определить Set_alphabet");
-                    break;
-                }
-
-                // Ожидаем: ( условие ) { тело }
-                token = lexer.next();
-                if (!expect(TokenType::LParen, "(")) break;
-                token = lexer.next();
-
-                // Парсим условие с помощью ConditionParser
-                ConditionParser condParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                ConditionPtr cond = condParser.parse();
-                if (!cond || !result.ok) break;
-
-                if (!expect(TokenType::RParen, ")")) break;
-                token = lexer.next();
-
-                if (!expect(TokenType::LBrace, "{")) break;
-                token = lexer.next();
-
-                // Парсинг вложенных блоков
-                IRBlock thenBranch;
-                std::vector<IRBlock*> blockStack;                           // стек родительских блоков
-                std::vector<std::shared_ptr<IRInstruction>> pendingIfStack; // стек if-ов, ожидающих else
-                
-                IRBlock* currentBlock = &thenBranch;                        // текущий блок для добавления инструкций
-                
-                // Парсим содержимое блока
-                while (result.ok && token.type != TokenType::Eof) {
-                    // Закрывающая скобка - конец текущего блока
-                    if (token.type == TokenType::RBrace) {
-                        if (!pendingIfStack.empty()) {
-                            // Завершаем внутренний if/else блок
-                            auto pendingIf = pendingIfStack.back();
-                            pendingIfStack.pop_back();
-                            
-                            if (!blockStack.empty()) {
-                                currentBlock = blockStack.back();
-                                blockStack.pop_back();
-                            }
-                            
-                            // Проверяем, есть ли else или else if после }
-                            token = lexer.next();
-                            if (token.type == TokenType::Identifier && token.value == "else") {
-                                token = lexer.next();
-                                if (token.type == TokenType::Identifier && token.value == "if") {
-                                    // else if - создаём вложенный if в else-ветке
-                                    int elseIfLine = token.line;
-                                    int elseIfCol = token.column;
-                                    token = lexer.next();
-                                    if (!expect(TokenType::LParen, "(")) break;
-                                    token = lexer.next();
-
-                                    // Парсим условие else if
-                                    ConditionParser elseIfCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                                    ConditionPtr elseIfCond = elseIfCondParser.parse();
-                                    if (!elseIfCond || !result.ok) break;
-
-                                    if (!expect(TokenType::RParen, ")")) break;
-                                    token = lexer.next();
-                                    if (!expect(TokenType::LBrace, "{")) break;
-                                    token = lexer.next();
-
-                                    // Создаём вложенный if внутри else-ветки
-                                    auto nestedElseIf = IRInstruction::ifElse(elseIfCond, IRBlock{}, IRBlock{}, elseIfLine, elseIfCol);
-                                    pendingIf->elseBranch.push_back(nestedElseIf);
-                                    blockStack.push_back(currentBlock);
-                                    pendingIfStack.push_back(nestedElseIf);
-                                    
-                                    // Сохраняем pendingIf для возможного else
-                                    blockStack.push_back(&pendingIf->elseBranch);
-                                    pendingIfStack.push_back(pendingIf);
-                                    currentBlock = &nestedElseIf->thenBranch;
-                                } else if (token.type == TokenType::LBrace) {
-                                    // else { ... } - парсим else-ветку
-                                    token = lexer.next();
-                                    blockStack.push_back(currentBlock);
-                                    pendingIfStack.push_back(pendingIf);
-                                    currentBlock = &pendingIf->elseBranch;
-                                } else {
-                                    error(token.line, token.column, "После 'else' ожидалась '{' или 'if'");
-                                    break;
-                                }
-                            } else {
-                                // Нет else - добавляем if в текущий блок
-                                currentBlock->push_back(pendingIf);
-                            }
-                        } else {
-                            // Конец главного if-блока
-                            break;
-                        }
-                    } else if (token.type == TokenType::Identifier) {
-                        // Парсим инструкции внутри блока
-                        const std::string innerCmd = token.value;
-                        const int innerLine = token.line;
-                        const int innerCol = token.column;
-
-                        if (innerCmd == "move_left") {
-                            token = lexer.next();
-                            if (!expect(TokenType::Semicolon, ";")) break;
-                            currentBlock->push_back(IRInstruction::simple(IRType::MoveLeft, "", innerLine, innerCol));
-                            token = lexer.next();
-                        } else if (innerCmd == "move_right") {
-                            token = lexer.next();
-                            if (!expect(TokenType::Semicolon, ";")) break;
-                            currentBlock->push_back(IRInstruction::simple(IRType::MoveRight, "", innerLine, innerCol));
-                            token = lexer.next();
-                        } else if (innerCmd == "write") {
-                            token = lexer.next();
-                            if (!expect(TokenType::StringLiteral, "символ для записи")) break;
-                            const std::string symStr = token.value;
-                            Symbol actualSym = (symStr == "blank") ? blankSymbol : symStr;
-                            if (actualSym != blankSymbol && !alphabetSet.count(actualSym)) {
-                                error(token.line, token.column, "Символ '" + symStr + "' не определён в алфавите");
-                                break;
-                            }
-                            token = lexer.next();
-                            if (!expect(TokenType::Semicolon, ";")) break;
-                            currentBlock->push_back(IRInstruction::simple(IRType::Write, actualSym, innerLine, innerCol));
-                            token = lexer.next();
-                        } else if (innerCmd == "call") {
-                            token = lexer.next();
-                            if (!expect(TokenType::Identifier, "имя процедуры")) break;
-                            const std::string pName = token.value;
-                            if (!procedures.count(pName)) {
-                                error(token.line, token.column, "Процедура '" + pName + "' не определена");
-                                break;
-                            }
-                            token = lexer.next();
-                            if (!expect(TokenType::Semicolon, ";")) break;
-                            currentBlock->push_back(IRInstruction::simple(IRType::Call, pName, innerLine, innerCol));
-                            token = lexer.next();
-                        } else if (innerCmd == "if") {
-                            // Вложенный if
-                            token = lexer.next();
-                            if (!expect(TokenType::LParen, "(")) break;
-                            token = lexer.next();
-
-                            ConditionParser innerCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                            ConditionPtr innerCond = innerCondParser.parse();
-                            if (!innerCond || !result.ok) break;
-
-                            if (!expect(TokenType::RParen, ")")) break;
-                            token = lexer.next();
-                            if (!expect(TokenType::LBrace, "{")) break;
-                            token = lexer.next();
-
-                            auto nestedIf = IRInstruction::ifElse(innerCond, IRBlock{}, IRBlock{}, innerLine, innerCol);
-                            blockStack.push_back(currentBlock);
-                            pendingIfStack.push_back(nestedIf);
-                            currentBlock = &nestedIf->thenBranch;
-                        } else if (innerCmd == "while") {
-                            // Вложенный while
-                            token = lexer.next();
-                            if (!expect(TokenType::LParen, "(")) break;
-                            token = lexer.next();
-
-                            ConditionParser innerCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                            ConditionPtr innerCond = innerCondParser.parse();
-                            if (!innerCond || !result.ok) break;
-
-                            if (!expect(TokenType::RParen, ")")) break;
-                            token = lexer.next();
-                            if (!expect(TokenType::LBrace, "{")) break;
-                            token = lexer.next();
-
-                            auto nestedWhile = IRInstruction::whileLoop(innerCond, IRBlock{}, innerLine, innerCol);
-                            blockStack.push_back(currentBlock);
-                            pendingIfStack.push_back(nestedWhile);
-                            currentBlock = &nestedWhile->thenBranch;
-                        } else if (innerCmd == "x") {
-                            // Операции с переменной x внутри if
-                            token = lexer.next();
-                            if (token.type == TokenType::Assign) {
-                                token = lexer.next();
-                                if (token.type != TokenType::Number) {
-                                    error(token.line, token.column, "После 'x =' ожидалось число");
-                                    break;
-                                }
-                                int value = 0;
-                                try { value = std::stoi(token.value); } catch (...) {
-                                    error(token.line, token.column, "Некорректное число");
-                                    break;
-                                }
-                                if (value < -128 || value > 127) {
-                                    error(token.line, token.column, "Значение должно быть в диапазоне [-128..127]");
-                                    break;
-                                }
-                                token = lexer.next();
-                                if (!expect(TokenType::Semicolon, ";")) break;
-                                currentBlock->push_back(IRInstruction::varSetConst(value, innerLine, innerCol));
-                                token = lexer.next();
-                            } else if (token.type == TokenType::PlusPlus) {
-                                token = lexer.next();
-                                if (!expect(TokenType::Semicolon, ";")) break;
-                                currentBlock->push_back(IRInstruction::varInc(innerLine, innerCol));
-                                token = lexer.next();
-                            } else if (token.type == TokenType::MinusMinus) {
-                                token = lexer.next();
-                                if (!expect(TokenType::Semicolon, ";")) break;
-                                currentBlock->push_back(IRInstruction::varDec(innerLine, innerCol));
-                                token = lexer.next();
-                            } else {
-                                error(token.line, token.column, "После 'x' ожидалось '=', '++' или '--'");
-                                break;
-                            }
-                        } else {
-                            error(innerLine, innerCol, "Неизвестная команда внутри if: '" + innerCmd + "'");
-                            break;
-                        }
-                    } else {
-                        error(token.line, token.column, "Ожидалась команда или '}'");
-                        break;
-                    }
-                }
-
-                if (!result.ok) break;
-
-                // Теперь проверяем наличие else или else if после основного блока if
-                token = lexer.next();
-                IRBlock elseBranch;
-                
-                if (token.type == TokenType::Identifier && token.value == "else") {
-                    token = lexer.next();
-                    
-                    if (token.type == TokenType::Identifier && token.value == "if") {
-                        // else if - парсим как вложенный if в else ветке
-                        int elseIfLine = token.line;
-                        int elseIfCol = token.column;
-                        token = lexer.next();
-                        if (!expect(TokenType::LParen, "(")) break;
-                        token = lexer.next();
-
-                        ConditionParser elseIfCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                        ConditionPtr elseIfCond = elseIfCondParser.parse();
-                        if (!elseIfCond || !result.ok) break;
-
-                        if (!expect(TokenType::RParen, ")")) break;
-                        token = lexer.next();
-                        if (!expect(TokenType::LBrace, "{")) break;
-                        token = lexer.next();
-
-                        auto nestedElseIf = IRInstruction::ifElse(elseIfCond, IRBlock{}, IRBlock{}, elseIfLine, elseIfCol);
-                        
-                        // Парсим тело else-if и возможную цепочку
-                        currentBlock = &nestedElseIf->thenBranch;
-                        pendingIfStack.clear();
-                        blockStack.clear();
-                        pendingIfStack.push_back(nestedElseIf);
-                        
-                        while (result.ok && token.type != TokenType::Eof) {
-                            if (token.type == TokenType::RBrace) {
-                                if (pendingIfStack.size() > 1) {
-                                    auto innerPending = pendingIfStack.back();
-                                    pendingIfStack.pop_back();
-                                    
-                                    if (!blockStack.empty()) {
-                                        currentBlock = blockStack.back();
-                                        blockStack.pop_back();
-                                    }
-                                    
-                                    token = lexer.next();
-                                    if (token.type == TokenType::Identifier && token.value == "else") {
-                                        token = lexer.next();
-                                        if (token.type == TokenType::Identifier && token.value == "if") {
-                                            // Очередной else if в цепочке
-                                            int chainLine = token.line;
-                                            int chainCol = token.column;
-                                            token = lexer.next();
-                                            if (!expect(TokenType::LParen, "(")) break;
-                                            token = lexer.next();
-
-                                            ConditionParser chainCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                                            ConditionPtr chainCond = chainCondParser.parse();
-                                            if (!chainCond || !result.ok) break;
-
-                                            if (!expect(TokenType::RParen, ")")) break;
-                                            token = lexer.next();
-                                            if (!expect(TokenType::LBrace, "{")) break;
-                                            token = lexer.next();
-
-                                            auto chainIf = IRInstruction::ifElse(chainCond, IRBlock{}, IRBlock{}, chainLine, chainCol);
-                                            innerPending->elseBranch.push_back(chainIf);
-                                            blockStack.push_back(currentBlock);
-                                            pendingIfStack.push_back(chainIf);
-                                            blockStack.push_back(&innerPending->elseBranch);
-                                            pendingIfStack.push_back(innerPending);
-                                            currentBlock = &chainIf->thenBranch;
-                                        } else if (token.type == TokenType::LBrace) {
-                                            token = lexer.next();
-                                            blockStack.push_back(currentBlock);
-                                            pendingIfStack.push_back(innerPending);
-                                            currentBlock = &innerPending->elseBranch;
-                                        } else {
-                                            error(token.line, token.column, "После 'else' ожидалась '{' или 'if'");
-                                            break;
-                                        }
-                                    } else {
-                                        currentBlock->push_back(innerPending);
-                                    }
-                                } else {
-                                    // Конец блока else-if
-                                    break;
-                                }
-                            } else if (token.type == TokenType::Identifier) {
-                                const std::string innerCmd = token.value;
-                                const int innerLine = token.line;
-                                const int innerCol = token.column;
-
-                                if (innerCmd == "move_left") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Semicolon, ";")) break;
-                                    currentBlock->push_back(IRInstruction::simple(IRType::MoveLeft, "", innerLine, innerCol));
-                                    token = lexer.next();
-                                } else if (innerCmd == "move_right") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Semicolon, ";")) break;
-                                    currentBlock->push_back(IRInstruction::simple(IRType::MoveRight, "", innerLine, innerCol));
-                                    token = lexer.next();
-                                } else if (innerCmd == "write") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::StringLiteral, "символ для записи")) break;
-                                    const std::string symStr = token.value;
-                                    Symbol actualSym = (symStr == "blank") ? blankSymbol : symStr;
-                                    if (actualSym != blankSymbol && !alphabetSet.count(actualSym)) {
-                                        error(token.line, token.column, "Символ '" + symStr + "' не определён в алфавите");
-                                        break;
-                                    }
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Semicolon, ";")) break;
-                                    currentBlock->push_back(IRInstruction::simple(IRType::Write, actualSym, innerLine, innerCol));
-                                    token = lexer.next();
-                                } else if (innerCmd == "call") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Identifier, "имя процедуры")) break;
-                                    const std::string pName = token.value;
-                                    if (!procedures.count(pName)) {
-                                        error(token.line, token.column, "Процедура '" + pName + "' не определена");
-                                        break;
-                                    }
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Semicolon, ";")) break;
-                                    currentBlock->push_back(IRInstruction::simple(IRType::Call, pName, innerLine, innerCol));
-                                    token = lexer.next();
-                                } else if (innerCmd == "if" || innerCmd == "while") {
-                                    bool isWhile = (innerCmd == "while");
-                                    token = lexer.next();
-                                    if (!expect(TokenType::LParen, "(")) break;
-                                    token = lexer.next();
-
-                                    ConditionParser innerCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                                    ConditionPtr innerCond = innerCondParser.parse();
-                                    if (!innerCond || !result.ok) break;
-
-                                    if (!expect(TokenType::RParen, ")")) break;
-                                    token = lexer.next();
-                                    if (!expect(TokenType::LBrace, "{")) break;
-                                    token = lexer.next();
-
-                                    auto nested = isWhile 
-                                        ? IRInstruction::whileLoop(innerCond, IRBlock{}, innerLine, innerCol)
-                                        : IRInstruction::ifElse(innerCond, IRBlock{}, IRBlock{}, innerLine, innerCol);
-                                    blockStack.push_back(currentBlock);
-                                    pendingIfStack.push_back(nested);
-                                    currentBlock = &nested->thenBranch;
-                                } else if (innerCmd == "x") {
-                                    token = lexer.next();
-                                    if (token.type == TokenType::Assign) {
-                                        token = lexer.next();
-                                        if (token.type != TokenType::Number) {
-                                            error(token.line, token.column, "После 'x =' ожидалось число");
-                                            break;
-                                        }
-                                        int value = 0;
-                                        try { value = std::stoi(token.value); } catch (...) {
-                                            error(token.line, token.column, "Некорректное число");
-                                            break;
-                                        }
-                                        if (value < -128 || value > 127) {
-                                            error(token.line, token.column, "Значение должно быть в диапазоне [-128..127]");
-                                            break;
-                                        }
-                                        token = lexer.next();
-                                        if (!expect(TokenType::Semicolon, ";")) break;
-                                        currentBlock->push_back(IRInstruction::varSetConst(value, innerLine, innerCol));
-                                        token = lexer.next();
-                                    } else if (token.type == TokenType::PlusPlus) {
-                                        token = lexer.next();
-                                        if (!expect(TokenType::Semicolon, ";")) break;
-                                        currentBlock->push_back(IRInstruction::varInc(innerLine, innerCol));
-                                        token = lexer.next();
-                                    } else if (token.type == TokenType::MinusMinus) {
-                                        token = lexer.next();
-                                        if (!expect(TokenType::Semicolon, ";")) break;
-                                        currentBlock->push_back(IRInstruction::varDec(innerLine, innerCol));
-                                        token = lexer.next();
-                                    } else {
-                                        error(token.line, token.column, "После 'x' ожидалось '=', '++' или '--'");
-                                        break;
-                                    }
-                                } else {
-                                    error(innerLine, innerCol, "Неизвестная команда внутри else if: '" + innerCmd + "'");
-                                    break;
-                                }
-                            } else {
-                                error(token.line, token.column, "Ожидалась команда или '}'");
-                                break;
-                            }
-                        }
-                        
-                        if (!result.ok) break;
-                        
-                        // Проверяем наличие else после цепочки else-if
-                        token = lexer.next();
-                        if (token.type == TokenType::Identifier && token.value == "else") {
-                            token = lexer.next();
-                            if (token.type == TokenType::LBrace) {
-                                // Финальный else
-                                token = lexer.next();
-                                currentBlock = &nestedElseIf->elseBranch;
-                                pendingIfStack.clear();
-                                blockStack.clear();
-                                
-                                while (result.ok && token.type != TokenType::Eof) {
-                                    if (token.type == TokenType::RBrace) {
-                                        if (!pendingIfStack.empty()) {
-                                            auto pend = pendingIfStack.back();
-                                            pendingIfStack.pop_back();
-                                            if (!blockStack.empty()) {
-                                                currentBlock = blockStack.back();
-                                                blockStack.pop_back();
-                                            }
-                                            token = lexer.next();
-                                            if (token.type == TokenType::Identifier && token.value == "else") {
-                                                token = lexer.next();
-                                                if (token.type == TokenType::LBrace) {
-                                                    token = lexer.next();
-                                                    blockStack.push_back(currentBlock);
-                                                    pendingIfStack.push_back(pend);
-                                                    currentBlock = &pend->elseBranch;
-                                                } else {
-                                                    error(token.line, token.column, "После 'else' ожидалась '{'");
-                                                    break;
-                                                }
-                                            } else {
-                                                currentBlock->push_back(pend);
-                                            }
-                                        } else {
-                                            break;
-                                        }
-                                    } else if (token.type == TokenType::Identifier) {
-                                        const std::string ic = token.value;
-                                        const int il = token.line;
-                                        const int icol = token.column;
-
-                                        if (ic == "move_left") {
-                                            token = lexer.next();
-                                            if (!expect(TokenType::Semicolon, ";")) break;
-                                            currentBlock->push_back(IRInstruction::simple(IRType::MoveLeft, "", il, icol));
-                                            token = lexer.next();
-                                        } else if (ic == "move_right") {
-                                            token = lexer.next();
-                                            if (!expect(TokenType::Semicolon, ";")) break;
-                                            currentBlock->push_back(IRInstruction::simple(IRType::MoveRight, "", il, icol));
-                                            token = lexer.next();
-                                        } else if (ic == "write") {
-                                            token = lexer.next();
-                                            if (!expect(TokenType::StringLiteral, "символ")) break;
-                                            Symbol s = (token.value == "blank") ? blankSymbol : token.value;
-                                            if (s != blankSymbol && !alphabetSet.count(s)) {
-                                                error(token.line, token.column, "Символ не в алфавите");
-                                                break;
-                                            }
-                                            token = lexer.next();
-                                            if (!expect(TokenType::Semicolon, ";")) break;
-                                            currentBlock->push_back(IRInstruction::simple(IRType::Write, s, il, icol));
-                                            token = lexer.next();
-                                        } else if (ic == "call") {
-                                            token = lexer.next();
-                                            if (!expect(TokenType::Identifier, "имя")) break;
-                                            if (!procedures.count(token.value)) {
-                                                error(token.line, token.column, "Процедура не найдена");
-                                                break;
-                                            }
-                                            std::string pn = token.value;
-                                            token = lexer.next();
-                                            if (!expect(TokenType::Semicolon, ";")) break;
-                                            currentBlock->push_back(IRInstruction::simple(IRType::Call, pn, il, icol));
-                                            token = lexer.next();
-                                        } else if (ic == "if" || ic == "while") {
-                                            bool isW = (ic == "while");
-                                            token = lexer.next();
-                                            if (!expect(TokenType::LParen, "(")) break;
-                                            token = lexer.next();
-                                            ConditionParser cp(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                                            auto cd = cp.parse();
-                                            if (!cd || !result.ok) break;
-                                            if (!expect(TokenType::RParen, ")")) break;
-                                            token = lexer.next();
-                                            if (!expect(TokenType::LBrace, "{")) break;
-                                            token = lexer.next();
-                                            auto n = isW ? IRInstruction::whileLoop(cd, IRBlock{}, il, icol)
-                                                         : IRInstruction::ifElse(cd, IRBlock{}, IRBlock{}, il, icol);
-                                            blockStack.push_back(currentBlock);
-                                            pendingIfStack.push_back(n);
-                                            currentBlock = &n->thenBranch;
-                                        } else if (ic == "x") {
-                                            token = lexer.next();
-                                            if (token.type == TokenType::Assign) {
-                                                token = lexer.next();
-                                                if (token.type != TokenType::Number) {
-                                                    error(token.line, token.column, "После 'x =' ожидалось число");
-                                                    break;
-                                                }
-                                                int value = 0;
-                                                try { value = std::stoi(token.value); } catch (...) {
-                                                    error(token.line, token.column, "Некорректное число");
-                                                    break;
-                                                }
-                                                if (value < -128 || value > 127) {
-                                                    error(token.line, token.column, "Значение должно быть в диапазоне [-128..127]");
-                                                    break;
-                                                }
-                                                token = lexer.next();
-                                                if (!expect(TokenType::Semicolon, ";")) break;
-                                                currentBlock->push_back(IRInstruction::varSetConst(value, il, icol));
-                                                token = lexer.next();
-                                            } else if (token.type == TokenType::PlusPlus) {
-                                                token = lexer.next();
-                                                if (!expect(TokenType::Semicolon, ";")) break;
-                                                currentBlock->push_back(IRInstruction::varInc(il, icol));
-                                                token = lexer.next();
-                                            } else if (token.type == TokenType::MinusMinus) {
-                                                token = lexer.next();
-                                                if (!expect(TokenType::Semicolon, ";")) break;
-                                                currentBlock->push_back(IRInstruction::varDec(il, icol));
-                                                token = lexer.next();
-                                            } else {
-                                                error(token.line, token.column, "После 'x' ожидалось '=', '++' или '--'");
-                                                break;
-                                            }
-                                        } else {
-                                            error(il, icol, "Неизвестная команда");
-                                            break;
-                                        }
-                                    } else {
-                                        error(token.line, token.column, "Ожидалась команда");
-                                        break;
-                                    }
-                                }
-                                if (!result.ok) break;
-                                token = lexer.next();
-                            } else {
-                                error(token.line, token.column, "После 'else' ожидалась '{'");
-                                break;
-                            }
-                        }
-                        
-                        elseBranch.push_back(nestedElseIf);
-                    } else if (token.type == TokenType::LBrace) {
-                        token = lexer.next();
-
-                        // Парсим ветку else (та же логика)
-                        currentBlock = &elseBranch;
-                        pendingIfStack.clear();
-                        blockStack.clear();
-                        
-                        while (result.ok && token.type != TokenType::Eof) {
-                            if (token.type == TokenType::RBrace) {
-                                if (!pendingIfStack.empty()) {
-                                    auto pendingIf = pendingIfStack.back();
-                                    pendingIfStack.pop_back();
-                                    
-                                    if (!blockStack.empty()) {
-                                        currentBlock = blockStack.back();
-                                        blockStack.pop_back();
-                                    }
-                                    
-                                    token = lexer.next();
-                                    if (token.type == TokenType::Identifier && token.value == "else") {
-                                        token = lexer.next();
-                                        if (!expect(TokenType::LBrace, "{")) break;
-                                        token = lexer.next();
-                                        
-                                        blockStack.push_back(currentBlock);
-                                        pendingIfStack.push_back(pendingIf);
-                                        currentBlock = &pendingIf->elseBranch;
-                                    } else {
-                                        currentBlock->push_back(pendingIf);
-                                    }
-                                } else {
-                                    break;
-                                }
-                            } else if (token.type == TokenType::Identifier) {
-                                const std::string innerCmd = token.value;
-                                const int innerLine = token.line;
-                                const int innerCol = token.column;
-
-                                if (innerCmd == "move_left") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Semicolon, ";")) break;
-                                    currentBlock->push_back(IRInstruction::simple(IRType::MoveLeft, "", innerLine, innerCol));
-                                    token = lexer.next();
-                                } else if (innerCmd == "move_right") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Semicolon, ";")) break;
-                                    currentBlock->push_back(IRInstruction::simple(IRType::MoveRight, "", innerLine, innerCol));
-                                    token = lexer.next();
-                                } else if (innerCmd == "write") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::StringLiteral, "символ для записи")) break;
-                                    const std::string symStr = token.value;
-                                    Symbol actualSym = (symStr == "blank") ? blankSymbol : symStr;
-                                    if (actualSym != blankSymbol && !alphabetSet.count(actualSym)) {
-                                        error(token.line, token.column, "Символ '" + symStr + "' не определён в алфавите");
-                                        break;
-                                    }
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Semicolon, ";")) break;
-                                    currentBlock->push_back(IRInstruction::simple(IRType::Write, actualSym, innerLine, innerCol));
-                                    token = lexer.next();
-                                } else if (innerCmd == "call") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Identifier, "имя процедуры")) break;
-                                    const std::string pName = token.value;
-                                    if (!procedures.count(pName)) {
-                                        error(token.line, token.column, "Процедура '" + pName + "' не определена");
-                                        break;
-                                    }
-                                    token = lexer.next();
-                                    if (!expect(TokenType::Semicolon, ";")) break;
-                                    currentBlock->push_back(IRInstruction::simple(IRType::Call, pName, innerLine, innerCol));
-                                    token = lexer.next();
-                                } else if (innerCmd == "if") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::LParen, "(")) break;
-                                    token = lexer.next();
-
-                                    ConditionParser innerCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                                    ConditionPtr innerCond = innerCondParser.parse();
-                                    if (!innerCond || !result.ok) break;
-
-                                    if (!expect(TokenType::RParen, ")")) break;
-                                    token = lexer.next();
-                                    if (!expect(TokenType::LBrace, "{")) break;
-                                    token = lexer.next();
-
-                                    auto nestedIf = IRInstruction::ifElse(innerCond, IRBlock{}, IRBlock{}, innerLine, innerCol);
-                                    blockStack.push_back(currentBlock);
-                                    pendingIfStack.push_back(nestedIf);
-                                    currentBlock = &nestedIf->thenBranch;
-                                } else if (innerCmd == "while") {
-                                    token = lexer.next();
-                                    if (!expect(TokenType::LParen, "(")) break;
-                                    token = lexer.next();
-
-                                    ConditionParser innerCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                                    ConditionPtr innerCond = innerCondParser.parse();
-                                    if (!innerCond || !result.ok) break;
-
-                                    if (!expect(TokenType::RParen, ")")) break;
-                                    token = lexer.next();
-                                    if (!expect(TokenType::LBrace, "{")) break;
-                                    token = lexer.next();
-
-                                    auto nestedWhile = IRInstruction::whileLoop(innerCond, IRBlock{}, innerLine, innerCol);
-                                    blockStack.push_back(currentBlock);
-                                    pendingIfStack.push_back(nestedWhile);
-                                    currentBlock = &nestedWhile->thenBranch;
-                                } else if (innerCmd == "x") {
-                                    token = lexer.next();
-                                    if (token.type == TokenType::Assign) {
-                                        token = lexer.next();
-                                        if (token.type != TokenType::Number) {
-                                            error(token.line, token.column, "После 'x =' ожидалось число");
-                                            break;
-                                        }
-                                        int value = 0;
-                                        try { value = std::stoi(token.value); } catch (...) {
-                                            error(token.line, token.column, "Некорректное число");
-                                            break;
-                                        }
-                                        if (value < -128 || value > 127) {
-                                            error(token.line, token.column, "Значение должно быть в диапазоне [-128..127]");
-                                            break;
-                                        }
-                                        token = lexer.next();
-                                        if (!expect(TokenType::Semicolon, ";")) break;
-                                        currentBlock->push_back(IRInstruction::varSetConst(value, innerLine, innerCol));
-                                        token = lexer.next();
-                                    } else if (token.type == TokenType::PlusPlus) {
-                                        token = lexer.next();
-                                        if (!expect(TokenType::Semicolon, ";")) break;
-                                        currentBlock->push_back(IRInstruction::varInc(innerLine, innerCol));
-                                        token = lexer.next();
-                                    } else if (token.type == TokenType::MinusMinus) {
-                                        token = lexer.next();
-                                        if (!expect(TokenType::Semicolon, ";")) break;
-                                        currentBlock->push_back(IRInstruction::varDec(innerLine, innerCol));
-                                        token = lexer.next();
-                                    } else {
-                                        error(token.line, token.column, "После 'x' ожидалось '=', '++' или '--'");
-                                        break;
-                                    }
-                                } else {
-                                    error(innerLine, innerCol, "Неизвестная команда внутри else: '" + innerCmd + "'");
-                                    break;
-                                }
-                            } else {
-                                error(token.line, token.column, "Ожидалась команда или '}'");
-                                break;
-                            }
-                        }
-                        
-                        if (!result.ok) break;
-                        token = lexer.next();
-                    } else {
-                        error(token.line, token.column, "После 'else' ожидалась '{' или 'if'");
-                        break;
-                    }
-                }
-
-                // Создаём итоговую IR-инструкцию if/else с обеими ветками
-                auto ifInstr = IRInstruction::ifElse(cond, std::move(thenBranch), std::move(elseBranch), cmdLine, cmdCol);
-                if (!addInstruction(ifInstr)) break;
-
-            // Цикл: while (условие) { ... }
-            } else if (cmd == "while") {
-                if (!alphabetDefined) {
-                    error(cmdLine, cmdCol, "while: сначала нужно определить Set_alphabet");
-                    break;
-                }
-
-                // Ожидаем: ( условие ) { тело }
-                token = lexer.next();
-                if (!expect(TokenType::LParen, "(")) break;
-                token = lexer.next();
-
-                // Парсим условие
-                ConditionParser condParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                ConditionPtr cond = condParser.parse();
-                if (!cond || !result.ok) break;
-
-                if (!expect(TokenType::RParen, ")")) break;
-                token = lexer.next();
-
-                if (!expect(TokenType::LBrace, "{")) break;
-                token = lexer.next();
-
-                // Парсинг тела цикла
-                // Аналогично if - используем стек для вложенных конструкций.
-                IRBlock loopBody;
-                std::vector<IRBlock*> blockStack;
-                std::vector<std::shared_ptr<IRInstruction>> pendingIfStack;
-                
-                IRBlock* currentBlock = &loopBody;
-                
-                while (result.ok && token.type != TokenType::Eof) {
-                    if (token.type == TokenType::RBrace) {
-                        if (!pendingIfStack.empty()) {
-                            auto pendingIf = pendingIfStack.back();
-                            pendingIfStack.pop_back();
-                            
-                            if (!blockStack.empty()) {
-                                currentBlock = blockStack.back();
-                                blockStack.pop_back();
-                            }
-                            
-                            token = lexer.next();
-                            if (token.type == TokenType::Identifier && token.value == "else") {
-                                token = lexer.next();
-                                if (!expect(TokenType::LBrace, "{")) break;
-                                token = lexer.next();
-                                
-                                blockStack.push_back(currentBlock);
-                                pendingIfStack.push_back(pendingIf);
-                                currentBlock = &pendingIf->elseBranch;
-                            } else {
-                                currentBlock->push_back(pendingIf);
-                            }
-                        } else {
-                            break;
-                        }
-                    } else if (token.type == TokenType::Identifier) {
-                        const std::string innerCmd = token.value;
-                        const int innerLine = token.line;
-                        const int innerCol = token.column;
-
-                        if (innerCmd == "move_left") {
-                            token = lexer.next();
-                            if (!expect(TokenType::Semicolon, ";")) break;
-                            currentBlock->push_back(IRInstruction::simple(IRType::MoveLeft, "", innerLine, innerCol));
-                            token = lexer.next();
-                        } else if (innerCmd == "move_right") {
-                            token = lexer.next();
-                            if (!expect(TokenType::Semicolon, ";")) break;
-                            currentBlock->push_back(IRInstruction::simple(IRType::MoveRight, "", innerLine, innerCol));
-                            token = lexer.next();
-                        } else if (innerCmd == "write") {
-                            token = lexer.next();
-                            if (!expect(TokenType::StringLiteral, "символ для записи")) break;
-                            const std::string symStr = token.value;
-                            Symbol actualSym = (symStr == "blank") ? blankSymbol : symStr;
-                            if (actualSym != blankSymbol && !alphabetSet.count(actualSym)) {
-                                error(token.line, token.column, "Символ '" + symStr + "' не определён в алфавите");
-                                break;
-                            }
-                            token = lexer.next();
-                            if (!expect(TokenType::Semicolon, ";")) break;
-                            currentBlock->push_back(IRInstruction::simple(IRType::Write, actualSym, innerLine, innerCol));
-                            token = lexer.next();
-                        } else if (innerCmd == "call") {
-                            token = lexer.next();
-                            if (!expect(TokenType::Identifier, "имя процедуры")) break;
-                            const std::string pName = token.value;
-                            if (!procedures.count(pName)) {
-                                error(token.line, token.column, "Процедура '" + pName + "' не определена");
-                                break;
-                            }
-                            token = lexer.next();
-                            if (!expect(TokenType::Semicolon, ";")) break;
-                            currentBlock->push_back(IRInstruction::simple(IRType::Call, pName, innerLine, innerCol));
-                            token = lexer.next();
-                        } else if (innerCmd == "if") {
-                            token = lexer.next();
-                            if (!expect(TokenType::LParen, "(")) break;
-                            token = lexer.next();
-
-                            ConditionParser innerCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                            ConditionPtr innerCond = innerCondParser.parse();
-                            if (!innerCond || !result.ok) break;
+    result.diagnostics.push_back({DiagnosticLevel::Info, 0, 0, "Компиляция отменена"});
+    return result;
+}
 
-                            if (!expect(TokenType::RParen, ")")) break;
-                            token = lexer.next();
-                            if (!expect(TokenType::LBrace, "{")) break;
-                            token = lexer.next();
+void reportPhase(CompileProgress* progress, CompilePhase phase) {
+    if (progress) {
+        progress->report(phase, 0, 1);
+    }
+}
 
-                            auto nestedIf = IRInstruction::ifElse(innerCond, IRBlock{}, IRBlock{}, innerLine, innerCol);
-                            blockStack.push_back(currentBlock);
-                            pendingIfStack.push_back(nestedIf);
-                            currentBlock = &nestedIf->thenBranch;
-                        } else if (innerCmd == "while") {
-                            token = lexer.next();
-                            if (!expect(TokenType::LParen, "(")) break;
-                            token = lexer.next();
+/** @brief Строки инструкций в прямом обходе, включая вложенные блоки */
+void collectLines(const IRBlock& block, std::vector<int>& lines) {
+    for (const auto& instr : block) {
+        lines.push_back(instr->line);
+        collectLines(instr->thenBranch, lines);
+        collectLines(instr->elseBranch, lines);
+    }
+}
 
-                            ConditionParser innerCondParser(lexer, token, alphabetSet, blankSymbol, result.diagnostics, result.ok);
-                            ConditionPtr innerCond = innerCondParser.parse();
-                            if (!innerCond || !result.ok) break;
+/**
+ * @brief Соответствие старых строк новым для программы, сдвинутой в тексте
+ *
+ * from и to - строки одних и тех же инструкций. Если одна старая строка
+ * перешла в разные новые, отметки таблицы не восстановить - false.
+ */
+bool matchLines(const std::vector<int>& from, const std::vector<int>& to, std::unordered_map<int, int>& lines) {
+    if (from.size() != to.size()) return false;
+    lines = {{0, 0}};  // Служебные состояния остаются без строки
+    for (std::size_t i = 0; i < from.size(); i++) {
+        auto [it, inserted] = lines.emplace(from[i], to[i]);
+        if (!inserted && it->second != to[i]) return false;
+    }
+    return true;
+}
 
-                            if (!expect(TokenType::RParen, ")")) break;
-                            token = lexer.next();
-                            if (!expect(TokenType::LBrace, "{")) break;
-                            token = lexer.next();
+} // namespace
 
-                            auto nestedWhile = IRInstruction::whileLoop(innerCond, IRBlock{}, innerLine, innerCol);
-                            blockStack.push_back(currentBlock);
-                            pendingIfStack.push_back(nestedWhile);
-                            currentBlock = &nestedWhile->thenBranch;
-                        } else if (innerCmd == "x") {
-                            token = lexer.next();
-                            if (token.type == TokenType::Assign) {
-                                token = lexer.next();
-                                if (token.type != TokenType::Number) {
-                                    error(token.line, token.column, "После 'x =' ожидалось число");
-                                    break;
-                                }
-                                int value = 0;
-                                try { value = std::stoi(token.value); } catch (...) {
-                                    error(token.line, token.column, "Некорректное число");
-                                    break;
-                                }
-                                if (value < -128 || value > 127) {
-                                    error(token.line, token.column, "Значение должно быть в диапазоне [-128..127]");
-                                    break;
-                                }
-                                token = lexer.next();
-                                if (!expect(TokenType::Semicolon, ";")) break;
-                                currentBlock->push_back(IRInstruction::varSetConst(value, innerLine, innerCol));
-                                token = lexer.next();
-                            } else if (token.type == TokenType::PlusPlus) {
-                                token = lexer.next();
-                                if (!expect(TokenType::Semicolon, ";")) break;
-                                currentBlock->push_back(IRInstruction::varInc(innerLine, innerCol));
-                                token = lexer.next();
-                            } else if (token.type == TokenType::MinusMinus) {
-                                token = lexer.next();
-                                if (!expect(TokenType::Semicolon, ";")) break;
-                                currentBlock->push_back(IRInstruction::varDec(innerLine, innerCol));
-                                token = lexer.next();
-                            } else {
-                                error(token.line, token.column, "После 'x' ожидалось '=', '++' или '--'");
-                                break;
-                            }
-                        } else {
-                            error(innerLine, innerCol, "Неизвестная команда внутри while: '" + innerCmd + "'");
-                            break;
-                        }
-                    } else {
-                        error(token.line, token.column, "Ожидалась команда или '}'");
-                        break;
-                    }
-                }
+CompileResult Compiler::compile(std::string_view source) const {
+    return compileImpl(source, nullptr, nullptr);
+}
 
-                if (!result.ok) break;
-                token = lexer.next();
+CompileResult Compiler::compile(std::string_view source, CompileCache& cache) const {
+    return compileImpl(source, &cache, nullptr);
+}
 
-                // Создаём IR-инструкцию while с телом цикла
-                auto whileInstr = IRInstruction::whileLoop(cond, std::move(loopBody), cmdLine, cmdCol);
-                if (!addInstruction(whileInstr)) break;
+CompileResult Compiler::compile(std::string_view source, CompileCache& cache, CompileProgress& progress) const {
+    CompileResult result = compileImpl(source, &cache, &progress);
+    reportPhase(&progress, CompilePhase::Done);
+    return result;
+}
 
-            // Операции с переменной x
-            } else if (cmd == "x") {
-                if (!alphabetDefined) {
-                    error(cmdLine, cmdCol, "x: сначала нужно определить Set_alphabet");
-                    break;
-                }
+CompileResult Compiler::compileImpl(std::string_view source, CompileCache* cache, CompileProgress* progress) const {
+    if (options_.lazyCodegen) {
+        // IR переходит в результат, а кэши хранят только готовые таблицы
+        CompileResult result = compileSource(source, nullptr, progress);
+        return isCancelled(progress) ? cancelledResult() : result;
+    }
 
-                // Смотрим следующий токен: = (присваивание), ++ или --
-                token = lexer.next();
-                
-                if (token.type == TokenType::Assign) {
-                    // x = <число>;
-                    token = lexer.next();
-                    if (token.type != TokenType::Number) {
-                        error(token.line, token.column, "После 'x =' ожидалось число");
-                        break;
-                    }
-                    
-                    int value = 0;
-                    try {
-                        value = std::stoi(token.value);
-                    } catch (...) {
-                        error(token.line, token.column, "Некорректное число: '" + token.value + "'");
-                        break;
-                    }
-                    
-                    // Проверка диапазона [-128; 127]
-                    if (value < -128 || value > 127) {
-                        error(token.line, token.column, "Значение должно быть в диапазоне [-128..127]");
-                        break;
-                    }
-                    
-                    token = lexer.next();
-                    if (!expect(TokenType::Semicolon, ";")) break;
-                    
-                    if (!addInstruction(IRInstruction::varSetConst(value, cmdLine, cmdCol))) break;
-                    token = lexer.next();
-                    
-                } else if (token.type == TokenType::PlusPlus) {
-                    // x++;
-                    token = lexer.next();
-                    if (!expect(TokenType::Semicolon, ";")) break;
-                    
-                    if (!addInstruction(IRInstruction::varInc(cmdLine, cmdCol))) break;
-                    token = lexer.next();
-                    
-                } else if (token.type == TokenType::MinusMinus) {
-                    // x--;
-                    token = lexer.next();
-                    if (!expect(TokenType::Semicolon, ";")) break;
-                    
-                    if (!addInstruction(IRInstruction::varDec(cmdLine, cmdCol))) break;
-                    token = lexer.next();
-                    
-                } else {
-                    error(token.line, token.column, "После 'x' ожидалось '=', '++' или '--'");
-                    break;
-                }
+    std::optional<DiskCache> disk;
+    if (!options_.diskCache.directory.empty()) {
+        disk.emplace(options_.diskCache, compilerFingerprint(options_));
+        CompileResult stored;
+        if (disk->load(source, stored)) {
+            stored.diagnostics.push_back({DiagnosticLevel::Info, 0, 0, "Кэш: результат взят с диска"});
+            return stored;
+        }
+    }
 
-            } else {
-                // Неизвестная команда
-                error(cmdLine, cmdCol, "Неизвестная команда: '" + cmd + "'");
-                break;
-            }
-        } else if (token.type == TokenType::RBrace) {
-            // Закрывающая скобка: конец тела процедуры
-            if (!currentProc) {
-                error(token.line, token.column, "Неожиданная '}'");
-                break;
-            }
-            currentProc = nullptr;  // Выходим из текущей процедуры
-            token = lexer.next();
+    CompileResult result = compileSource(source, cache, progress);
+    if (isCancelled(progress)) {
+        return cancelledResult();
+    }
+    if (disk) {
+        disk->store(source, result);
+    }
+    if (cache && result.ok) {
+        result.diagnostics.push_back({DiagnosticLevel::Info, 0, 0,
+            "Кэш: процедур разобрано - " + std::to_string(cache->parsedProcedures) +
+            ", взято из кэша - " + std::to_string(cache->reusedProcedures) +
+            (cache->reusedTable ? ", таблица переходов не изменилась" : "")});
+    }
+    return result;
+}
 
-        } else if (token.type == TokenType::Unknown) {
-            // Неизвестный символ - ошибка лексера
-            error(token.line, token.column, "Неожиданный символ: '" + token.value + "'");
-            break;
-        } else {
-            // Ожидали команду, но получили что-то другое
-            error(token.line, token.column, "Ожидалась команда");
-            break;
-        }
+CompileResult Compiler::compileSource(std::string_view source, CompileCache* cache, CompileProgress* progress) const {
+    CompileResult result;
+    result.ok = true;
+    if (cache) {
+        cache->beginCompile();
     }
 
-    
-    // Наличие незакрытой процедуры
-    if (result.ok && currentProc) {
-        error(currentProc->line, currentProc->column, "Процедура '" + currentProc->name + "' не закрыта (отсутствует '}')");
+    // Узлы IR и условий живут до конца компиляции; с кэшем - до следующей
+    auto arenaOwner = std::make_unique<IRArena>();
+    IRArena& arena = *arenaOwner;
+    Parser parser(source, arena, result, cache, progress);
+    parser.parse();
+    const auto& procedures = parser.procedures();
+    if (isCancelled(progress)) {
+        return result;
     }
 
     // Наличие процедуры main (точка входа)
@@ -1330,10 +178,10 @@ CompileResult Compiler::compile(std::string_view source) const {
     }
 
     // Предупреждения о пропущенных командах
-    if (result.ok && !alphabetDefined) {
+    if (result.ok && !parser.alphabetDefined()) {
         result.diagnostics.push_back({DiagnosticLevel::Warning, 1, 1, "Set_alphabet не определён"});
     }
-    if (result.ok && !setupDefined) {
+    if (result.ok && !parser.setupDefined()) {
         result.diagnostics.push_back({DiagnosticLevel::Warning, 1, 1, "Setup не определён"});
     }
 
@@ -1343,8 +191,7 @@ CompileResult Compiler::compile(std::string_view source) const {
 
     // Добавляем системные символы в алфавит
     auto addToAlphabet = [&](const Symbol& sym) {
-        if (!alphabetSet.count(sym)) {
-            alphabetSet.insert(sym);
+        if (std::find(result.alphabet.begin(), result.alphabet.end(), sym) == result.alphabet.end()) {
             result.alphabet.push_back(sym);
         }
     };
@@ -1369,11 +216,119 @@ CompileResult Compiler::compile(std::string_view source) const {
     if (result.ok && procedures.count("main")) {
         IRBlock flatInstructions;
         std::unordered_set<std::string> callStack;  // Для обнаружения рекурсии
+        FlattenMemo flattened;                      // Тела, уже развёрнутые для других вызовов
         
         // Рекурсивно разворачиваем все call в тело соответствующих процедур
-        if (flattenProcedure("main", procedures, flatInstructions, callStack, result.diagnostics)) {
-            // Генерируем переходы МТ из плоского IR-кода
-            generateTransitions(flatInstructions, result.alphabet, result.table);
+        reportPhase(progress, CompilePhase::Flattening);
+        if (flattenProcedure("main", procedures, arena, flatInstructions, callStack, flattened, result.diagnostics)) {
+            // Оптимизация IR: известные значения x и peephole-упрощения
+            if (isCancelled(progress)) {
+                return result;
+            }
+            reportPhase(progress, CompilePhase::Optimizing);
+            const bool emptyMain = flatInstructions.empty();
+            IRPassManager passes;
+            if (options_.trackVariable) {
+                passes.add("track-variable", [this, &arena](IRBlock& block) {
+                    VarTrackingStats stats = trackVariable(block, arena, options_.unrollBudget);
+                    return stats.removedVarOps + stats.foldedConditions + stats.unrolledLoops;
+                });
+            }
+            addPeepholePasses(passes, options_.irPasses, result.alphabet);
+            for (const auto& report : passes.run(flatInstructions)) {
+                if (report.removed > 0) {
+                    result.diagnostics.push_back({DiagnosticLevel::Info, 0, 0,
+                        "IR: " + report.name + " - удалено " + std::to_string(report.removed)});
+                }
+            }
+            if (flatInstructions.empty() && !emptyMain) {
+                // Программа сократилась целиком: пустое условие - один шаг до останова,
+                // иначе startState совпадёт с haltState
+                flatInstructions.push_back(IRInstruction::ifElse(arena, nullptr, {}, {}, 0, 0));
+            }
+
+            // Символы, которые могут быть в пользовательской зоне до запуска
+            std::vector<Symbol> tapeSymbols;
+            for (const auto& sym : result.alphabet) {
+                if (sym != MemoryLayout::kSymBOM && sym != MemoryLayout::kSymEOM &&
+                    sym != MemoryLayout::kBit0 && sym != MemoryLayout::kBit1 &&
+                    sym != MemoryLayout::kPosMarker) {
+                    tapeSymbols.push_back(sym);
+                }
+            }
+
+            // Строки берутся сейчас: записи кэша процедур могут сдвинуться при следующей правке
+            std::vector<int> programLines;
+            collectLines(flatInstructions, programLines);
+            std::unordered_map<int, int> movedLines;
+
+            if (cache && cache->hasTable && cache->programAlphabet == result.alphabet &&
+                cache->programTape == result.initialTape && sameBlock(cache->program, flatInstructions) &&
+                matchLines(cache->programLines, programLines, movedLines)) {
+                // Программа не изменилась после оптимизаций - таблица та же, строки могли сдвинуться
+                result.alphabet = cache->tableAlphabet;
+                result.table = cache->table;
+                cache->table.forEachSourceLine([&](StateId first, int line) {
+                    result.table.setSourceLine(first, movedLines.at(line));
+                });
+                cache->table = result.table;
+                cache->programLines = std::move(programLines);
+                cache->reusedTable = true;
+            } else {
+                const std::vector<Symbol> programAlphabet = result.alphabet;
+                // Маркеры #<символ> нужны только операциям с переменной в фиксированной памяти
+                CodegenOptions codegen = options_.codegen;
+                codegen.sharedMarkerChains = codegen.sharedMarkerChains &&
+                    codegen.memoryPlacement == MemoryLayout::Placement::Fixed &&
+                    usesVariable(flatInstructions) && addMarkerSymbols(result.alphabet);
+
+                // Генерируем переходы МТ из плоского IR-кода
+                if (isCancelled(progress)) {
+                    return result;
+                }
+                if (options_.lazyCodegen) {
+                    // Переходы сгенерирует интерпретатор при первом входе в состояние
+                    auto lazy = std::make_shared<const LazyTransitions>(
+                        std::move(flatInstructions), std::move(arenaOwner), result.alphabet, codegen);
+                    result.table.startState = lazy->startState();
+                    result.table.haltState = lazy->haltState();
+                    result.lazy = std::move(lazy);
+                    return result;
+                }
+                generateTransitions(flatInstructions, result.alphabet, result.table, codegen, progress);
+                if (isCancelled(progress)) {
+                    // Таблица неполная: в кэш документа она не попадает
+                    return result;
+                }
+
+                // Peephole-оптимизация готовой таблицы
+                reportPhase(progress, CompilePhase::TableOptimizing);
+                if (options_.foldStayTransitions) {
+                    foldStayTransitions(result.table);
+                    removeUnreachableStates(result.table);
+                }
+                if (options_.pruneImpossibleRules &&
+                    codegen.memoryPlacement == MemoryLayout::Placement::Fixed) {
+                    removeImpossibleTransitions(result.table, result.initialTape, tapeSymbols, progress);
+                }
+                if (isCancelled(progress)) {
+                    return result;
+                }
+
+                if (cache) {
+                    cache->programAlphabet = programAlphabet;
+                    cache->programTape = result.initialTape;
+                    cache->tableAlphabet = result.alphabet;
+                    cache->table = result.table;
+                    cache->programLines = std::move(programLines);
+                    cache->hasTable = true;
+                }
+            }
+            if (cache) {
+                // Узлы новой программы заменяют прошлые: на старые записи кэша она не ссылается
+                cache->program = std::move(flatInstructions);
+                cache->programArena = std::move(arenaOwner);
+            }
         } else {
             result.ok = false;
         }
@@ -1388,6 +343,15 @@ CompileResult Compiler::compile(std::string_view source) const {
         result.ok = result.table.validate(result.diagnostics);
     }
 
+    if (cache && result.ok) {
+        if (!procedures.count("main")) {
+            cache->program.clear();
+            cache->programArena.reset();
+            cache->hasTable = false;
+        }
+        cache->endCompile();
+    }
+
     return result;
 }
 
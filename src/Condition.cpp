@@ -1,4 +1,56 @@
 #include "Condition.h"
+#include "IR.h"
+
+ConditionPtr Condition::readEq(IRArena& arena, const std::string& sym, int l, int c) {
+    Condition* cond = arena.conditions.create();
+    cond->type = ConditionType::ReadEq;
+    cond->symbol = sym;
+    cond->line = l;
+    cond->column = c;
+    return cond;
+}
+
+ConditionPtr Condition::readNeq(IRArena& arena, const std::string& sym, int l, int c) {
+    Condition* cond = arena.conditions.create();
+    cond->type = ConditionType::ReadNeq;
+    cond->symbol = sym;
+    cond->line = l;
+    cond->column = c;
+    return cond;
+}
+
+ConditionPtr Condition::binaryOp(IRArena& arena, ConditionType t, ConditionPtr l, ConditionPtr r) {
+    Condition* cond = arena.conditions.create();
+    cond->type = t;
+    cond->left = l;
+    cond->right = r;
+    return cond;
+}
+
+ConditionPtr Condition::notOp(IRArena& arena, ConditionPtr op) {
+    Condition* cond = arena.conditions.create();
+    cond->type = ConditionType::Not;
+    cond->operand = op;
+    return cond;
+}
+
+ConditionPtr Condition::varLtConst(IRArena& arena, int value, int l, int c) {
+    Condition* cond = arena.conditions.create();
+    cond->type = ConditionType::VarLtConst;
+    cond->intValue = value;
+    cond->line = l;
+    cond->column = c;
+    return cond;
+}
+
+ConditionPtr Condition::varGtConst(IRArena& arena, int value, int l, int c) {
+    Condition* cond = arena.conditions.create();
+    cond->type = ConditionType::VarGtConst;
+    cond->intValue = value;
+    cond->line = l;
+    cond->column = c;
+    return cond;
+}
 
 bool containsVarCondition(const ConditionPtr& cond) {
     if (!cond) return false;
@@ -48,12 +100,14 @@ ConditionParser::ConditionParser(
     Token& currentToken,
     const std::unordered_set<Symbol>& alphabetSet,
     const Symbol& blankSymbol,
+    IRArena& arena,
     std::vector<Diagnostic>& diagnostics,
     bool& ok)
     : lexer_(lexer)
     , token_(currentToken)
     , alphabetSet_(alphabetSet)
     , blankSymbol_(blankSymbol)
+    , arena_(arena)
     , diagnostics_(diagnostics)
     , ok_(ok) {}
 
@@ -74,7 +128,7 @@ ConditionPtr ConditionParser::parseOr() {
         token_ = lexer_.next();
         auto right = parseXor();
         if (!right) return nullptr;
-        left = Condition::binaryOp(ConditionType::Or, left, right);
+        left = Condition::binaryOp(arena_, ConditionType::Or, left, right);
     }
     return left;
 }
@@ -87,7 +141,7 @@ ConditionPtr ConditionParser::parseXor() {
         token_ = lexer_.next();
         auto right = parseAnd();
         if (!right) return nullptr;
-        left = Condition::binaryOp(ConditionType::Xor, left, right);
+        left = Condition::binaryOp(arena_, ConditionType::Xor, left, right);
     }
     return left;
 }
@@ -100,25 +154,47 @@ ConditionPtr ConditionParser::parseAnd() {
         token_ = lexer_.next();
         auto right = parseNot();
         if (!right) return nullptr;
-        left = Condition::binaryOp(ConditionType::And, left, right);
+        left = Condition::binaryOp(arena_, ConditionType::And, left, right);
     }
     return left;
 }
 
 ConditionPtr ConditionParser::parseNot() {
-    if (token_.type == TokenType::Identifier && token_.value == "not") {
+    // Цепочка not разбирается циклом; каждый not - уровень вложенности дерева
+    const int startLine = token_.line;
+    const int startCol = token_.column;
+    int notCount = 0;
+    while (token_.type == TokenType::Identifier && token_.value == "not") {
         token_ = lexer_.next();
-        auto operand = parseNot();
-        if (!operand) return nullptr;
-        return Condition::notOp(operand);
+        notCount++;
+    }
+    if (depth_ + notCount > kMaxNestingDepth) {
+        error(startLine, startCol, "Слишком глубокая вложенность условия (больше " +
+              std::to_string(kMaxNestingDepth) + ")");
+        return nullptr;
     }
-    return parsePrimary();
+
+    depth_ += notCount;
+    auto operand = parsePrimary();
+    depth_ -= notCount;
+    if (!operand) return nullptr;
+    for (int i = 0; i < notCount; i++) {
+        operand = Condition::notOp(arena_, operand);
+    }
+    return operand;
 }
 
 ConditionPtr ConditionParser::parsePrimary() {
     if (token_.type == TokenType::LParen) {
+        if (depth_ >= kMaxNestingDepth) {
+            error(token_.line, token_.column, "Слишком глубокая вложенность условия (больше " +
+                  std::to_string(kMaxNestingDepth) + ")");
+            return nullptr;
+        }
         token_ = lexer_.next();
+        depth_++;
         auto inner = parseOr();
+        depth_--;
         if (!inner) return nullptr;
         if (token_.type != TokenType::RParen) {
             error(token_.line, token_.column, "Ожидалась ')'");
@@ -151,10 +227,8 @@ ConditionPtr ConditionParser::parsePrimary() {
         }
 
         int value = 0;
-        try {
-            value = std::stoi(token_.value);
-        } catch (...) {
-            error(token_.line, token_.column, "Некорректное число: '" + token_.value + "'");
+        if (!parseNumber(token_.value, value)) {
+            error(token_.line, token_.column, "Некорректное число: '" + std::string(token_.value) + "'");
             return nullptr;
         }
 
@@ -166,9 +240,9 @@ ConditionPtr ConditionParser::parsePrimary() {
 
         token_ = lexer_.next();
         if (isLess) {
-            return Condition::varLtConst(value, xLine, xCol);
+            return Condition::varLtConst(arena_, value, xLine, xCol);
         } else {
-            return Condition::varGtConst(value, xLine, xCol);
+            return Condition::varGtConst(arena_, value, xLine, xCol);
         }
     }
 
@@ -193,7 +267,7 @@ ConditionPtr ConditionParser::parsePrimary() {
             return nullptr;
         }
 
-        std::string symStr = token_.value;
+        std::string symStr(token_.value);
         Symbol sym = (symStr == "blank") ? blankSymbol_ : symStr;
 
         if (sym != blankSymbol_ && !alphabetSet_.count(sym)) {
@@ -204,9 +278,9 @@ ConditionPtr ConditionParser::parsePrimary() {
         token_ = lexer_.next();
 
         if (isEq) {
-            return Condition::readEq(sym, readLine, readCol);
+            return Condition::readEq(arena_, sym, readLine, readCol);
         } else {
-            return Condition::readNeq(sym, readLine, readCol);
+            return Condition::readNeq(arena_, sym, readLine, readCol);
         }
     }
 
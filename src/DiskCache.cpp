@@ -0,0 +1,323 @@
+#include "DiskCache.h"
+#include "Compiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[4] = {'T', 'M', 'C', 'C'};
+constexpr std::uint32_t kFormatVersion = 2;  // Увеличивать при изменении раскладки записи
+constexpr const char* kExtension = ".tmc";
+
+/** @brief FNV-1a: хеш не зависит от стандартной библиотеки и запуска */
+std::uint64_t fnv1a(std::string_view data, std::uint64_t h = 14695981039346656037ull) {
+    for (const unsigned char c : data) {
+        h = (h ^ c) * 1099511628211ull;
+    }
+    return h;
+}
+
+/** @brief Запись в буфер (порядок байт машины: кэш локальный) */
+class Writer {
+public:
+    void u8(std::uint8_t v) { raw(&v, sizeof v); }
+    void u32(std::uint32_t v) { raw(&v, sizeof v); }
+    void i32(std::int32_t v) { raw(&v, sizeof v); }
+    void i64(std::int64_t v) { raw(&v, sizeof v); }
+    void str(std::string_view s) {
+        u32(static_cast<std::uint32_t>(s.size()));
+        buffer_.append(s.data(), s.size());
+    }
+    void raw(const void* data, std::size_t size) {
+        buffer_.append(static_cast<const char*>(data), size);
+    }
+    const std::string& buffer() const { return buffer_; }
+
+private:
+    std::string buffer_;
+};
+
+/** @brief Чтение буфера с проверкой границ; после первой ошибки ok() == false */
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    std::uint8_t u8() { std::uint8_t v = 0; raw(&v, sizeof v); return v; }
+    std::uint32_t u32() { std::uint32_t v = 0; raw(&v, sizeof v); return v; }
+    std::int32_t i32() { std::int32_t v = 0; raw(&v, sizeof v); return v; }
+    std::int64_t i64() { std::int64_t v = 0; raw(&v, sizeof v); return v; }
+    std::string str() {
+        const std::uint32_t size = u32();
+        if (!ok_ || size > data_.size() - pos_) {
+            ok_ = false;
+            return {};
+        }
+        std::string s(data_.substr(pos_, size));
+        pos_ += size;
+        return s;
+    }
+    /** @brief Число элементов; каждый занимает хотя бы байт, иначе запись повреждена */
+    std::uint32_t count() {
+        const std::uint32_t n = u32();
+        if (n > data_.size() - pos_) ok_ = false;
+        return ok_ ? n : 0;
+    }
+    void raw(void* out, std::size_t size) {
+        if (!ok_ || size > data_.size() - pos_) {
+            ok_ = false;
+            return;
+        }
+        std::memcpy(out, data_.data() + pos_, size);
+        pos_ += size;
+    }
+    void fail() { ok_ = false; }
+    bool ok() const { return ok_; }
+    bool atEnd() const { return pos_ == data_.size(); }
+
+private:
+    std::string_view data_;
+    std::size_t pos_{0};
+    bool ok_{true};
+};
+
+void writeTransition(Writer& w, const Transition& t) {
+    w.i32(t.nextState);
+    w.str(t.writeSymbol);
+    w.u8(static_cast<std::uint8_t>(t.move));
+}
+
+Transition readTransition(Reader& r) {
+    Transition t;
+    t.nextState = r.i32();
+    t.writeSymbol = r.str();
+    const std::uint8_t move = r.u8();
+    if (move > static_cast<std::uint8_t>(Move::Stay)) {
+        r.fail();
+    }
+    t.move = static_cast<Move>(move);
+    return t;
+}
+
+void writeResult(Writer& w, const CompileResult& result) {
+    w.u8(result.ok ? 1 : 0);
+
+    w.u32(static_cast<std::uint32_t>(result.diagnostics.size()));
+    for (const auto& diag : result.diagnostics) {
+        w.u8(static_cast<std::uint8_t>(diag.level));
+        w.i32(diag.line);
+        w.i32(diag.column);
+        w.str(diag.message);
+    }
+
+    w.u32(static_cast<std::uint32_t>(result.alphabet.size()));
+    for (const auto& sym : result.alphabet) {
+        w.str(sym);
+    }
+
+    std::vector<std::pair<long long, Symbol>> cells;
+    result.initialTape.forEachCell([&](long long pos, const Symbol& sym) { cells.emplace_back(pos, sym); });
+    w.str(result.initialTape.blank());
+    w.u32(static_cast<std::uint32_t>(cells.size()));
+    for (const auto& [pos, sym] : cells) {
+        w.i64(pos);
+        w.str(sym);
+    }
+
+    const TransitionTable& table = result.table;
+    w.i32(table.startState);
+    w.i32(table.haltState);
+    w.u32(static_cast<std::uint32_t>(table.symbolClasses().size()));
+    for (const auto& [member, rep] : table.symbolClasses()) {
+        w.str(member);
+        w.str(rep);
+    }
+    std::size_t rules = 0;
+    table.forEach([&](StateId, const Symbol&, const Transition&) { rules++; });
+    w.u32(static_cast<std::uint32_t>(rules));
+    table.forEach([&](StateId state, const Symbol& symbol, const Transition& t) {
+        w.i32(state);
+        w.str(symbol);
+        writeTransition(w, t);
+    });
+    std::size_t defaults = 0;
+    table.forEachDefault([&](StateId, const Transition&) { defaults++; });
+    w.u32(static_cast<std::uint32_t>(defaults));
+    table.forEachDefault([&](StateId state, const Transition& t) {
+        w.i32(state);
+        writeTransition(w, t);
+    });
+    std::size_t sourceLines = 0;
+    table.forEachSourceLine([&](StateId, int) { sourceLines++; });
+    w.u32(static_cast<std::uint32_t>(sourceLines));
+    table.forEachSourceLine([&](StateId first, int line) {
+        w.i32(first);
+        w.i32(line);
+    });
+}
+
+bool readResult(Reader& r, CompileResult& result) {
+    result.ok = r.u8() != 0;
+
+    for (std::uint32_t n = r.count(); n > 0 && r.ok(); n--) {
+        Diagnostic diag;
+        const std::uint8_t level = r.u8();
+        if (level > static_cast<std::uint8_t>(DiagnosticLevel::Info)) r.fail();
+        diag.level = static_cast<DiagnosticLevel>(level);
+        diag.line = r.i32();
+        diag.column = r.i32();
+        diag.message = r.str();
+        result.diagnostics.push_back(std::move(diag));
+    }
+
+    for (std::uint32_t n = r.count(); n > 0 && r.ok(); n--) {
+        result.alphabet.push_back(r.str());
+    }
+
+    result.initialTape = Tape(r.str());
+    for (std::uint32_t n = r.count(); n > 0 && r.ok(); n--) {
+        const long long pos = r.i64();
+        result.initialTape.set(pos, r.str());
+    }
+
+    TransitionTable& table = result.table;
+    table.startState = r.i32();
+    table.haltState = r.i32();
+    std::unordered_map<Symbol, Symbol> classes;
+    for (std::uint32_t n = r.count(); n > 0 && r.ok(); n--) {
+        Symbol member = r.str();
+        classes[std::move(member)] = r.str();
+    }
+    table.setSymbolClasses(std::move(classes));
+    for (std::uint32_t n = r.count(); n > 0 && r.ok(); n--) {
+        const StateId state = r.i32();
+        Symbol symbol = r.str();
+        table.add(state, std::move(symbol), readTransition(r));
+    }
+    for (std::uint32_t n = r.count(); n > 0 && r.ok(); n--) {
+        const StateId state = r.i32();
+        table.setDefault(state, readTransition(r));
+    }
+    for (std::uint32_t n = r.count(); n > 0 && r.ok(); n--) {
+        const StateId first = r.i32();
+        table.setSourceLine(first, r.i32());
+    }
+    return r.ok() && r.atEnd();
+}
+
+} // namespace
+
+DiskCache::DiskCache(DiskCacheOptions options, std::string fingerprint)
+    : options_(std::move(options))
+    , fingerprint_(std::move(fingerprint)) {}
+
+fs::path DiskCache::entryPath(std::string_view source) const {
+    const std::uint64_t h = fnv1a(source, fnv1a(std::string_view(fingerprint_.c_str(), fingerprint_.size() + 1)));
+    char name[17];
+    static const char* const kHex = "0123456789abcdef";
+    for (int i = 0; i < 16; i++) {
+        name[i] = kHex[(h >> (60 - 4 * i)) & 0xF];
+    }
+    name[16] = '\0';
+    return options_.directory / (std::string(name) + kExtension);
+}
+
+bool DiskCache::load(std::string_view source, CompileResult& out) const {
+    const fs::path path = entryPath(source);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    Reader r(data);
+    char magic[sizeof kMagic];
+    r.raw(magic, sizeof magic);
+    bool valid = r.ok() && std::memcmp(magic, kMagic, sizeof kMagic) == 0 &&
+                 r.u32() == kFormatVersion && r.str() == fingerprint_ && r.str() == source;
+    CompileResult result;
+    valid = valid && readResult(r, result);
+
+    if (!valid) {
+        // Повреждённая или чужая (совпал хеш) запись - перезапишется при сохранении
+        return false;
+    }
+    // Отметка использования для вытеснения
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    out = std::move(result);
+    return true;
+}
+
+void DiskCache::store(std::string_view source, const CompileResult& result) const {
+    Writer w;
+    w.raw(kMagic, sizeof kMagic);
+    w.u32(kFormatVersion);
+    w.str(fingerprint_);
+    w.str(source);
+    writeResult(w, result);
+
+    std::error_code ec;
+    fs::create_directories(options_.directory, ec);
+    const fs::path path = entryPath(source);
+    // Временный файл уникален для потока, чтобы параллельные записи не смешивались
+    fs::path tmp = path;
+    tmp += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + "." +
+           std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        if (!file) return;
+        file.write(w.buffer().data(), static_cast<std::streamsize>(w.buffer().size()));
+        if (!file) {
+            file.close();
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return;
+    }
+    evict();
+}
+
+void DiskCache::evict() const {
+    struct Entry {
+        fs::file_time_type used;
+        std::uintmax_t size;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    std::uintmax_t total = 0;
+
+    std::error_code ec;
+    for (fs::directory_iterator it(options_.directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != kExtension) continue;
+        std::error_code entryEc;
+        const std::uintmax_t size = it->file_size(entryEc);
+        const fs::file_time_type used = it->last_write_time(entryEc);
+        if (entryEc) continue;
+        entries.push_back({used, size, it->path()});
+        total += size;
+    }
+    if (total <= options_.maxBytes) return;
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total <= options_.maxBytes) break;
+        if (fs::remove(entry.path, ec)) {
+            total -= entry.size;
+        }
+    }
+}
@@ -4,16 +4,20 @@ namespace {
 bool flattenBlock(
     const IRBlock& block,
     const std::unordered_map<std::string, Procedure>& procedures,
+    IRArena& arena,
     IRBlock& output,
     std::unordered_set<std::string>& callStack,
+    FlattenMemo& memo,
     std::vector<Diagnostic>& diagnostics);
 }
 
 bool flattenProcedure(
     const std::string& procName,
     const std::unordered_map<std::string, Procedure>& procedures,
+    IRArena& arena,
     IRBlock& output,
     std::unordered_set<std::string>& callStack,
+    FlattenMemo& memo,
     std::vector<Diagnostic>& diagnostics
 ) {
     if (callStack.count(procName)) {
@@ -22,6 +26,20 @@ bool flattenProcedure(
         return false;
     }
 
+    auto cached = memo.find(procName);
+    if (cached != memo.end()) {
+        // Повторный вызов: тело уже развёрнуто, его узлы становятся общими.
+        // Флаг нужен только if/while - их flatten создаёт заново; листья остаются
+        // узлами разбора и не меняются
+        for (IRInstruction* instr : cached->second) {
+            if (instr->type == IRType::IfElse || instr->type == IRType::While) {
+                instr->shared = true;
+            }
+        }
+        output.insert(output.end(), cached->second.begin(), cached->second.end());
+        return true;
+    }
+
     auto it = procedures.find(procName);
     if (it == procedures.end()) {
         diagnostics.push_back({DiagnosticLevel::Error, 0, 0,
@@ -29,40 +47,47 @@ bool flattenProcedure(
         return false;
     }
 
+    IRBlock flat;
     callStack.insert(procName);
-    bool ok = flattenBlock(it->second.body, procedures, output, callStack, diagnostics);
+    bool ok = flattenBlock(it->second.body, procedures, arena, flat, callStack, memo, diagnostics);
     callStack.erase(procName);
-    return ok;
+    if (!ok) return false;
+
+    output.insert(output.end(), flat.begin(), flat.end());
+    memo.emplace(procName, std::move(flat));
+    return true;
 }
 
 namespace {
 bool flattenBlock(
     const IRBlock& block,
     const std::unordered_map<std::string, Procedure>& procedures,
+    IRArena& arena,
     IRBlock& output,
     std::unordered_set<std::string>& callStack,
+    FlattenMemo& memo,
     std::vector<Diagnostic>& diagnostics
 ) {
     for (const auto& instr : block) {
         if (instr->type == IRType::Call) {
-            if (!flattenProcedure(instr->argument, procedures, output, callStack, diagnostics)) {
+            if (!flattenProcedure(instr->argument, procedures, arena, output, callStack, memo, diagnostics)) {
                 return false;
             }
         } else if (instr->type == IRType::IfElse) {
             IRBlock flatThen, flatElse;
-            if (!flattenBlock(instr->thenBranch, procedures, flatThen, callStack, diagnostics)) {
+            if (!flattenBlock(instr->thenBranch, procedures, arena, flatThen, callStack, memo, diagnostics)) {
                 return false;
             }
-            if (!flattenBlock(instr->elseBranch, procedures, flatElse, callStack, diagnostics)) {
+            if (!flattenBlock(instr->elseBranch, procedures, arena, flatElse, callStack, memo, diagnostics)) {
                 return false;
             }
-            output.push_back(IRInstruction::ifElse(instr->condition, flatThen, flatElse, instr->line, instr->column));
+            output.push_back(IRInstruction::ifElse(arena, instr->condition, flatThen, flatElse, instr->line, instr->column));
         } else if (instr->type == IRType::While) {
             IRBlock flatBody;
-            if (!flattenBlock(instr->thenBranch, procedures, flatBody, callStack, diagnostics)) {
+            if (!flattenBlock(instr->thenBranch, procedures, arena, flatBody, callStack, memo, diagnostics)) {
                 return false;
             }
-            output.push_back(IRInstruction::whileLoop(instr->condition, flatBody, instr->line, instr->column));
+            output.push_back(IRInstruction::whileLoop(arena, instr->condition, flatBody, instr->line, instr->column));
         } else {
             output.push_back(instr);
         }
@@ -1,7 +1,7 @@
 #include "IR.h"
 
-std::shared_ptr<IRInstruction> IRInstruction::simple(IRType t, const std::string& arg, int l, int c) {
-    auto instr = std::make_shared<IRInstruction>();
+IRInstruction* IRInstruction::simple(IRArena& arena, IRType t, const std::string& arg, int l, int c) {
+    IRInstruction* instr = arena.instructions.create();
     instr->type = t;
     instr->argument = arg;
     instr->line = l;
@@ -9,8 +9,8 @@ std::shared_ptr<IRInstruction> IRInstruction::simple(IRType t, const std::string
     return instr;
 }
 
-std::shared_ptr<IRInstruction> IRInstruction::ifElse(ConditionPtr cond, IRBlock thenB, IRBlock elseB, int l, int c) {
-    auto instr = std::make_shared<IRInstruction>();
+IRInstruction* IRInstruction::ifElse(IRArena& arena, ConditionPtr cond, IRBlock thenB, IRBlock elseB, int l, int c) {
+    IRInstruction* instr = arena.instructions.create();
     instr->type = IRType::IfElse;
     instr->condition = cond;
     instr->thenBranch = std::move(thenB);
@@ -20,8 +20,8 @@ std::shared_ptr<IRInstruction> IRInstruction::ifElse(ConditionPtr cond, IRBlock
     return instr;
 }
 
-std::shared_ptr<IRInstruction> IRInstruction::whileLoop(ConditionPtr cond, IRBlock body, int l, int c) {
-    auto instr = std::make_shared<IRInstruction>();
+IRInstruction* IRInstruction::whileLoop(IRArena& arena, ConditionPtr cond, IRBlock body, int l, int c) {
+    IRInstruction* instr = arena.instructions.create();
     instr->type = IRType::While;
     instr->condition = cond;
     instr->thenBranch = std::move(body);
@@ -30,8 +30,8 @@ std::shared_ptr<IRInstruction> IRInstruction::whileLoop(ConditionPtr cond, IRBlo
     return instr;
 }
 
-std::shared_ptr<IRInstruction> IRInstruction::varSetConst(int value, int l, int c) {
-    auto instr = std::make_shared<IRInstruction>();
+IRInstruction* IRInstruction::varSetConst(IRArena& arena, int value, int l, int c) {
+    IRInstruction* instr = arena.instructions.create();
     instr->type = IRType::VarSetConst;
     instr->intValue = value;
     instr->line = l;
@@ -39,16 +39,16 @@ std::shared_ptr<IRInstruction> IRInstruction::varSetConst(int value, int l, int
     return instr;
 }
 
-std::shared_ptr<IRInstruction> IRInstruction::varInc(int l, int c) {
-    auto instr = std::make_shared<IRInstruction>();
+IRInstruction* IRInstruction::varInc(IRArena& arena, int l, int c) {
+    IRInstruction* instr = arena.instructions.create();
     instr->type = IRType::VarInc;
     instr->line = l;
     instr->column = c;
     return instr;
 }
 
-std::shared_ptr<IRInstruction> IRInstruction::varDec(int l, int c) {
-    auto instr = std::make_shared<IRInstruction>();
+IRInstruction* IRInstruction::varDec(IRArena& arena, int l, int c) {
+    IRInstruction* instr = arena.instructions.create();
     instr->type = IRType::VarDec;
     instr->line = l;
     instr->column = c;
@@ -0,0 +1,170 @@
+#include "IRAnalysis.h"
+#include "MemoryLayout.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+namespace {
+
+// Неограниченное смещение влево
+constexpr long long kUnbounded = -(1LL << 40);
+
+/** @brief Нижние границы смещения головки относительно входа в блок */
+struct Displacement {
+    long long net{0};      // После выполнения блока
+    long long lowest{0};   // В любой момент выполнения блока
+};
+
+long long addBounded(long long a, long long b) {
+    if (a <= kUnbounded || b <= kUnbounded) return kUnbounded;
+    return std::max(a + b, kUnbounded);
+}
+
+Displacement analyzeBlock(const IRBlock& block);
+
+Displacement analyzeInstruction(const IRInstruction& instr) {
+    switch (instr.type) {
+    case IRType::MoveLeft:
+        return {-1, -1};
+    case IRType::MoveRight:
+        return {1, 0};
+    case IRType::IfElse: {
+        Displacement t = analyzeBlock(instr.thenBranch);
+        Displacement e = analyzeBlock(instr.elseBranch);
+        return {std::min(t.net, e.net), std::min(t.lowest, e.lowest)};
+    }
+    case IRType::While: {
+        // Каждая итерация начинается не левее входа, только если тело не уводит влево
+        Displacement body = analyzeBlock(instr.thenBranch);
+        if (body.net < 0) {
+            return {kUnbounded, kUnbounded};
+        }
+        return {0, std::min<long long>(0, body.lowest)};
+    }
+    default:
+        // Операции с переменной возвращают головку на место
+        return {0, 0};
+    }
+}
+
+void collectConditionSymbols(const ConditionPtr& cond, std::unordered_set<Symbol>& out) {
+    if (!cond) return;
+    if (cond->type == ConditionType::ReadEq || cond->type == ConditionType::ReadNeq) {
+        out.insert(cond->symbol);
+    }
+    collectConditionSymbols(cond->left, out);
+    collectConditionSymbols(cond->right, out);
+    collectConditionSymbols(cond->operand, out);
+}
+
+void collectUsedSymbols(const IRBlock& block, std::unordered_set<Symbol>& out) {
+    for (const auto& instr : block) {
+        if (instr->type == IRType::Write) {
+            out.insert(instr->argument);
+        }
+        collectConditionSymbols(instr->condition, out);
+        collectUsedSymbols(instr->thenBranch, out);
+        collectUsedSymbols(instr->elseBranch, out);
+    }
+}
+
+Displacement analyzeBlock(const IRBlock& block) {
+    Displacement acc;
+    for (const auto& instr : block) {
+        Displacement d = analyzeInstruction(*instr);
+        acc.lowest = std::min(acc.lowest, addBounded(acc.net, d.lowest));
+        acc.net = addBounded(acc.net, d.net);
+    }
+    return acc;
+}
+
+} // namespace
+
+bool headStaysInUserZone(const IRBlock& instructions) {
+    return analyzeBlock(instructions).lowest >= 0;
+}
+
+bool usesVariable(const IRBlock& instructions) {
+    for (const auto& instr : instructions) {
+        switch (instr->type) {
+        case IRType::VarSetConst:
+        case IRType::VarInc:
+        case IRType::VarDec:
+            return true;
+        case IRType::IfElse:
+        case IRType::While:
+            if (containsVarCondition(instr->condition) ||
+                usesVariable(instr->thenBranch) || usesVariable(instr->elseBranch)) {
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+std::vector<Symbol> indistinguishableSymbols(const IRBlock& instructions,
+                                             const std::vector<Symbol>& alphabet) {
+    std::unordered_set<Symbol> used;
+    collectUsedSymbols(instructions, used);
+
+    std::vector<Symbol> result;
+    for (const auto& sym : alphabet) {
+        if (sym == " " || sym.empty() || sym[0] == '#' || sym == MemoryLayout::kSymBOM ||
+            sym == MemoryLayout::kSymEOM || sym == MemoryLayout::kBit0 || sym == MemoryLayout::kBit1) {
+            continue;
+        }
+        if (!used.count(sym)) {
+            result.push_back(sym);
+        }
+    }
+    return result;
+}
+
+bool sameCondition(const ConditionPtr& a, const ConditionPtr& b) {
+    if (a == b) return true;
+    if (!a || !b) return false;
+    return a->type == b->type && a->symbol == b->symbol && a->intValue == b->intValue &&
+           sameCondition(a->left, b->left) && sameCondition(a->right, b->right) &&
+           sameCondition(a->operand, b->operand);
+}
+
+bool sameInstruction(const IRInstruction& a, const IRInstruction& b) {
+    return a.type == b.type && a.argument == b.argument && a.intValue == b.intValue &&
+           sameCondition(a.condition, b.condition) &&
+           sameBlock(a.thenBranch, b.thenBranch) && sameBlock(a.elseBranch, b.elseBranch);
+}
+
+bool sameBlock(const IRBlock& a, const IRBlock& b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i] && !sameInstruction(*a[i], *b[i])) return false;
+    }
+    return true;
+}
+
+std::size_t hashCondition(const ConditionPtr& cond) {
+    if (!cond) return 0;
+    std::size_t h = static_cast<std::size_t>(cond->type) + 1;
+    h = hashCombine(h, std::hash<std::string>{}(cond->symbol));
+    h = hashCombine(h, std::hash<int>{}(cond->intValue));
+    h = hashCombine(h, hashCondition(cond->left));
+    h = hashCombine(h, hashCondition(cond->right));
+    return hashCombine(h, hashCondition(cond->operand));
+}
+
+std::size_t hashInstruction(const IRInstruction& instr) {
+    std::size_t h = static_cast<std::size_t>(instr.type) + 1;
+    h = hashCombine(h, std::hash<std::string>{}(instr.argument));
+    h = hashCombine(h, std::hash<int>{}(instr.intValue));
+    h = hashCombine(h, hashCondition(instr.condition));
+    // Ветки разделяем длиной, чтобы {A}{B C} и {A B}{C} не совпадали
+    h = hashCombine(h, instr.thenBranch.size());
+    for (const auto& sub : instr.thenBranch) h = hashCombine(h, hashInstruction(*sub));
+    h = hashCombine(h, instr.elseBranch.size());
+    for (const auto& sub : instr.elseBranch) h = hashCombine(h, hashInstruction(*sub));
+    return h;
+}
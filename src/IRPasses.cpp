@@ -0,0 +1,199 @@
+#include "IRPasses.h"
+#include "IRAnalysis.h"
+
+#include <unordered_set>
+
+namespace {
+
+using Visited = std::unordered_set<const IRInstruction*>;
+
+std::size_t forEachBlock(IRBlock& block, const std::function<std::size_t(IRBlock&)>& fn, Visited& visited) {
+    std::size_t changed = 0;
+    for (auto& instr : block) {
+        if (instr->type == IRType::IfElse || instr->type == IRType::While) {
+            // Общий узел обрабатывается один раз - изменения видны во всех местах
+            if (instr->shared && !visited.insert(instr).second) continue;
+            changed += forEachBlock(instr->thenBranch, fn, visited);
+            changed += forEachBlock(instr->elseBranch, fn, visited);
+        }
+    }
+    return changed + fn(block);
+}
+
+/** @brief Применить fn к каждому блоку, начиная с самых вложенных */
+std::size_t forEachBlock(IRBlock& block, const std::function<std::size_t(IRBlock&)>& fn) {
+    Visited visited;
+    return forEachBlock(block, fn, visited);
+}
+
+/** @brief Перенести ветку узла в out; вложенные if/while общего узла остаются общими */
+void spliceBranch(IRBlock& out, const IRInstruction& from, const IRBlock& branch) {
+    for (IRInstruction* instr : branch) {
+        if (instr->type == IRType::IfElse || instr->type == IRType::While) {
+            instr->shared = instr->shared || from.shared;
+        }
+        out.push_back(instr);
+    }
+}
+
+std::size_t blockSize(const IRBlock& block) {
+    std::size_t n = 0;
+    for (const auto& instr : block) {
+        n += 1 + blockSize(instr->thenBranch) + blockSize(instr->elseBranch);
+    }
+    return n;
+}
+
+bool isMove(IRType t) {
+    return t == IRType::MoveLeft || t == IRType::MoveRight;
+}
+
+} // namespace
+
+void IRPassManager::add(std::string name, Pass pass) {
+    passes_.emplace_back(std::move(name), std::move(pass));
+}
+
+std::vector<PassReport> IRPassManager::run(IRBlock& instructions, int maxRounds) const {
+    std::vector<PassReport> reports;
+    for (const auto& [name, pass] : passes_) {
+        reports.push_back({name, 0});
+    }
+
+    for (int round = 0; round < maxRounds; round++) {
+        bool changed = false;
+        for (std::size_t i = 0; i < passes_.size(); i++) {
+            std::size_t removed = passes_[i].second(instructions);
+            reports[i].removed += removed;
+            changed = changed || removed > 0;
+        }
+        if (!changed) break;
+    }
+    return reports;
+}
+
+std::size_t removeConstantConditions(IRBlock& block, const std::vector<Symbol>& alphabet) {
+    // Условие без x, одинаковое для всех символов алфавита: 1 - истина, 0 - ложь
+    auto constantValue = [&](const ConditionPtr& cond) -> int {
+        if (!cond || containsVarCondition(cond) || alphabet.empty()) return -1;
+        const bool first = evaluateCondition(cond, alphabet.front());
+        for (const auto& sym : alphabet) {
+            if (evaluateCondition(cond, sym) != first) return -1;
+        }
+        return first ? 1 : 0;
+    };
+
+    return forEachBlock(block, [&](IRBlock& b) {
+        std::size_t removed = 0;
+        IRBlock out;
+        for (const auto& instr : b) {
+            const int value = (instr->type == IRType::IfElse || instr->type == IRType::While)
+                              ? constantValue(instr->condition) : -1;
+            if (instr->type == IRType::IfElse && value >= 0) {
+                // Остаётся только выбранная ветка
+                spliceBranch(out, *instr, value ? instr->thenBranch : instr->elseBranch);
+                removed += 1 + blockSize(value ? instr->elseBranch : instr->thenBranch);
+            } else if (instr->type == IRType::While && value == 0) {
+                removed += 1 + blockSize(instr->thenBranch);
+            } else {
+                out.push_back(instr);
+            }
+        }
+        b = std::move(out);
+        return removed;
+    });
+}
+
+std::size_t mergeIdenticalBranches(IRBlock& block) {
+    return forEachBlock(block, [](IRBlock& b) {
+        std::size_t removed = 0;
+        IRBlock out;
+        for (const auto& instr : b) {
+            // Проверка условия не меняет ни ленту, ни положение головки
+            if (instr->type == IRType::IfElse && !instr->thenBranch.empty() &&
+                sameBlock(instr->thenBranch, instr->elseBranch)) {
+                spliceBranch(out, *instr, instr->thenBranch);
+                removed += 1 + blockSize(instr->elseBranch);
+            } else {
+                out.push_back(instr);
+            }
+        }
+        b = std::move(out);
+        return removed;
+    });
+}
+
+std::size_t removeEmptyIfs(IRBlock& block) {
+    return forEachBlock(block, [](IRBlock& b) {
+        std::size_t removed = 0;
+        IRBlock out;
+        for (const auto& instr : b) {
+            if (instr->type == IRType::IfElse && instr->thenBranch.empty() &&
+                instr->elseBranch.empty()) {
+                removed++;
+            } else {
+                out.push_back(instr);
+            }
+        }
+        b = std::move(out);
+        return removed;
+    });
+}
+
+std::size_t cancelMovePairs(IRBlock& block) {
+    return forEachBlock(block, [](IRBlock& b) {
+        // Стек: встречное движение сокращает предыдущее (L L R R -> пусто)
+        std::size_t removed = 0;
+        IRBlock out;
+        for (const auto& instr : b) {
+            if (isMove(instr->type) && !out.empty() && isMove(out.back()->type) &&
+                out.back()->type != instr->type) {
+                out.pop_back();
+                removed += 2;
+            } else {
+                out.push_back(instr);
+            }
+        }
+        b = std::move(out);
+        return removed;
+    });
+}
+
+std::size_t removeOverwrittenWrites(IRBlock& block) {
+    return forEachBlock(block, [](IRBlock& b) {
+        std::size_t removed = 0;
+        IRBlock out;
+        for (const auto& instr : b) {
+            if (instr->type == IRType::Write && !out.empty() &&
+                out.back()->type == IRType::Write) {
+                out.back() = instr;
+                removed++;
+            } else {
+                out.push_back(instr);
+            }
+        }
+        b = std::move(out);
+        return removed;
+    });
+}
+
+void addPeepholePasses(IRPassManager& manager, const IRPassOptions& options,
+                       const std::vector<Symbol>& alphabet) {
+    if (options.constantConditions) {
+        manager.add("constant-conditions", [alphabet](IRBlock& b) {
+            return removeConstantConditions(b, alphabet);
+        });
+    }
+    if (options.identicalBranches) {
+        manager.add("identical-branches", mergeIdenticalBranches);
+    }
+    if (options.emptyIfs) {
+        manager.add("empty-ifs", removeEmptyIfs);
+    }
+    if (options.movePairs) {
+        manager.add("move-pairs", cancelMovePairs);
+    }
+    if (options.overwrittenWrites) {
+        manager.add("overwritten-writes", removeOverwrittenWrites);
+    }
+}
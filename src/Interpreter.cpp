@@ -1,30 +1,65 @@
 #include "Interpreter.h"
 
-StepResult Interpreter::step(TuringMachine& tm, const TransitionTable& table) {
+namespace {
+
+/**
+ * @brief Шаг машины, общий для всех представлений переходов
+ *
+ * lookup(state, rule) ищет правило для символа под головкой, write(rule)
+ * записывает символ; проверки останова, сдвиг и смена состояния одни.
+ */
+template <typename Rule, typename Lookup, typename Write>
+StepResult stepWith(TuringMachine& tm, StateId haltState, Lookup&& lookup, Write&& write) {
     // Уже остановлена
     if (tm.isHalted()) {
         return StepResult::Halted;
     }
 
     // Достигнуто состояние останова
-    if (tm.getState() == table.haltState) {
+    if (tm.getState() == haltState) {
         tm.setHalted(true);
         return StepResult::Halted;
     }
 
-    const Symbol current = tm.read();
-    
-    const Transition* transition = table.get(tm.getState(), current);
-    
-    if (!transition) {
+    Rule rule;
+    if (!lookup(tm.getState(), rule)) {
         tm.setHalted(true);
         return StepResult::NoTransition;
     }
 
     // Применить переход
-    tm.write(transition->writeSymbol);
-    tm.move(transition->move);
-    tm.setState(transition->nextState);
-    tm.setHalted(tm.getState() == table.haltState);
+    write(rule);
+    tm.move(rule.move);
+    tm.setState(rule.nextState);
+    tm.setHalted(tm.getState() == haltState);
     return tm.isHalted() ? StepResult::Halted : StepResult::Ok;
 }
+
+} // namespace
+
+StepResult Interpreter::step(TuringMachine& tm, const TransitionTable& table) {
+    return stepWith<Transition>(tm, table.haltState,
+        [&](StateId state, Transition& rule) { return table.lookup(state, tm.read(), rule); },
+        [&](const Transition& rule) { tm.write(rule.writeSymbol); });
+}
+
+StepResult Interpreter::step(TuringMachine& tm, const MachineImage& image) {
+    std::uint32_t symbol = MachineImageFormat::kNoSymbol;
+    return stepWith<ImageTransition>(tm, image.haltState(),
+        [&](StateId state, ImageTransition& rule) {
+            symbol = image.findSymbol(tm.read());
+            return image.lookup(state, symbol, rule);
+        },
+        [&](const ImageTransition& rule) {
+            // Символа нет в образе - правило по умолчанию оставило его на месте
+            if (rule.writeSymbol != symbol) {
+                tm.write(Symbol(image.symbolName(rule.writeSymbol)));
+            }
+        });
+}
+
+StepResult Interpreter::step(TuringMachine& tm, const LazyTransitions& table) {
+    return stepWith<Transition>(tm, table.haltState(),
+        [&](StateId state, Transition& rule) { return table.lookup(state, tm.read(), rule); },
+        [&](const Transition& rule) { tm.write(rule.writeSymbol); });
+}
@@ -1,6 +1,45 @@
 #include "Lexer.h"
 
-#include <cctype>
+#include <array>
+#include <charconv>
+
+namespace {
+
+// Классы символов: одна выборка из таблицы вместо цепочки сравнений
+enum CharClass : unsigned char {
+    kSpace = 1,        // Пробельный символ
+    kIdentStart = 2,   // Начало идентификатора
+    kIdentChar = 4,    // Продолжение идентификатора
+    kDigit = 8         // Цифра
+};
+
+constexpr std::array<unsigned char, 256> makeCharClasses() {
+    std::array<unsigned char, 256> classes{};
+    classes[' '] = classes['\t'] = classes['\n'] = classes['\r'] = kSpace;
+    for (int c = '0'; c <= '9'; c++) {
+        classes[c] = kDigit | kIdentChar;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        classes[c] = kIdentStart | kIdentChar;
+        classes[c - 'a' + 'A'] = kIdentStart | kIdentChar;
+    }
+    classes['_'] = kIdentStart | kIdentChar;
+    return classes;
+}
+
+constexpr std::array<unsigned char, 256> kCharClasses = makeCharClasses();
+
+bool hasClass(char c, unsigned char cls) {
+    return (kCharClasses[static_cast<unsigned char>(c)] & cls) != 0;
+}
+
+} // namespace
+
+bool parseNumber(std::string_view text, int& value) {
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    return ec == std::errc() && ptr == end;
+}
 
 Lexer::Lexer(std::string_view source)
     : source_(source) {}
@@ -9,101 +48,52 @@ Token Lexer::next() {
     skipWhitespace();
 
     if (pos_ >= source_.size()) {
-        return {TokenType::Eof, "", line_, column_};
+        return {TokenType::Eof, {}, line_, column_};
     }
 
     const int startLine = line_;
     const int startCol = column_;
     const char c = source_[pos_];
-
-    if (c == ';') {
-        advance();
-        return {TokenType::Semicolon, ";", startLine, startCol};
-    }
-
-    if (c == '{') {
-        advance();
-        return {TokenType::LBrace, "{", startLine, startCol};
-    }
-
-    if (c == '}') {
-        advance();
-        return {TokenType::RBrace, "}", startLine, startCol};
-    }
-
-    if (c == '(') {
-        advance();
-        return {TokenType::LParen, "(", startLine, startCol};
+    const char nextChar = pos_ + 1 < source_.size() ? source_[pos_ + 1] : '\0';
+
+    switch (c) {
+    case ';': return take(TokenType::Semicolon, 1, startLine, startCol);
+    case '{': return take(TokenType::LBrace, 1, startLine, startCol);
+    case '}': return take(TokenType::RBrace, 1, startLine, startCol);
+    case '(': return take(TokenType::LParen, 1, startLine, startCol);
+    case ')': return take(TokenType::RParen, 1, startLine, startCol);
+    // == (двойное равно) и = (присваивание)
+    case '=':
+        return nextChar == '=' ? take(TokenType::EqEq, 2, startLine, startCol)
+                               : take(TokenType::Assign, 1, startLine, startCol);
+    case '<': return take(TokenType::Less, 1, startLine, startCol);
+    case '>': return take(TokenType::Greater, 1, startLine, startCol);
+    case '"': return readStringLiteral(startLine, startCol);
+    default: break;
+    }
+
+    if (c == '!' && nextChar == '=') {
+        return take(TokenType::NotEq, 2, startLine, startCol);
     }
-
-    if (c == ')') {
-        advance();
-        return {TokenType::RParen, ")", startLine, startCol};
-    }
-
-    // == (двойное равно)
-    if (c == '=' && pos_ + 1 < source_.size() && source_[pos_ + 1] == '=') {
-        advance();
-        advance();
-        return {TokenType::EqEq, "==", startLine, startCol};
-    }
-
-    // = (одинарное равно - присваивание)
-    if (c == '=') {
-        advance();
-        return {TokenType::Assign, "=", startLine, startCol};
-    }
-
-    if (c == '!' && pos_ + 1 < source_.size() && source_[pos_ + 1] == '=') {
-        advance();
-        advance();
-        return {TokenType::NotEq, "!=", startLine, startCol};
-    }
-
-    // < (меньше)
-    if (c == '<') {
-        advance();
-        return {TokenType::Less, "<", startLine, startCol};
-    }
-
-    // > (больше)
-    if (c == '>') {
-        advance();
-        return {TokenType::Greater, ">", startLine, startCol};
-    }
-
     // ++ (инкремент)
-    if (c == '+' && pos_ + 1 < source_.size() && source_[pos_ + 1] == '+') {
-        advance();
-        advance();
-        return {TokenType::PlusPlus, "++", startLine, startCol};
+    if (c == '+' && nextChar == '+') {
+        return take(TokenType::PlusPlus, 2, startLine, startCol);
     }
-
     // -- (декремент)
-    if (c == '-' && pos_ + 1 < source_.size() && source_[pos_ + 1] == '-') {
-        advance();
-        advance();
-        return {TokenType::MinusMinus, "--", startLine, startCol};
-    }
-
-    if (c == '"') {
-        return readStringLiteral(startLine, startCol);
+    if (c == '-' && nextChar == '-') {
+        return take(TokenType::MinusMinus, 2, startLine, startCol);
     }
 
     // Числовой литерал (включая отрицательные числа)
-    if (std::isdigit(static_cast<unsigned char>(c)) || 
-        (c == '-' && pos_ + 1 < source_.size() && std::isdigit(static_cast<unsigned char>(source_[pos_ + 1])))) {
+    if (hasClass(c, kDigit) || (c == '-' && hasClass(nextChar, kDigit))) {
         return readNumber(startLine, startCol);
     }
 
-    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+    if (hasClass(c, kIdentStart)) {
         return readIdentifier(startLine, startCol);
     }
 
-    std::string val;
-    val.push_back(c);
-    advance();
-    return {TokenType::Unknown, val, startLine, startCol};
+    return take(TokenType::Unknown, 1, startLine, startCol);
 }
 
 void Lexer::advance() {
@@ -118,17 +108,28 @@ void Lexer::advance() {
     }
 }
 
+// Сдвиг на count символов без перевода строки
+void Lexer::advanceInLine(std::size_t count) {
+    pos_ += count;
+    column_ += static_cast<int>(count);
+}
+
+Token Lexer::take(TokenType type, std::size_t length, int startLine, int startCol) {
+    const std::string_view value = source_.substr(pos_, length);
+    advanceInLine(value.size());
+    return {type, value, startLine, startCol};
+}
+
 void Lexer::skipWhitespace() {
     while (pos_ < source_.size()) {
         const char c = source_[pos_];
 
-        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        if (hasClass(c, kSpace)) {
             advance();
         }
         else if (c == '/' && pos_ + 1 < source_.size() && source_[pos_ + 1] == '/') {
-            while (pos_ < source_.size() && source_[pos_] != '\n') {
-                advance();
-            }
+            const std::size_t end = source_.find('\n', pos_);
+            advanceInLine((end == std::string_view::npos ? source_.size() : end) - pos_);
         }
         else if (c == '/' && pos_ + 1 < source_.size() && source_[pos_ + 1] == '*') {
             advance();
@@ -150,17 +151,14 @@ void Lexer::skipWhitespace() {
 
 Token Lexer::readStringLiteral(int startLine, int startCol) {
     advance();
-    std::string value;
-
-    while (pos_ < source_.size() && source_[pos_] != '"') {
-        if (source_[pos_] == '\n') {
-            return {TokenType::Unknown, value, startLine, startCol};
-        }
-        value.push_back(source_[pos_]);
-        advance();
-    }
-
-    if (pos_ >= source_.size()) {
+    const std::size_t start = pos_;
+    const std::size_t end = source_.find_first_of("\"\n", start);
+    const std::size_t stop = end == std::string_view::npos ? source_.size() : end;
+    const std::string_view value = source_.substr(start, stop - start);
+    advanceInLine(value.size());
+
+    // Перевод строки или конец файла до закрывающей кавычки
+    if (pos_ >= source_.size() || source_[pos_] == '\n') {
         return {TokenType::Unknown, value, startLine, startCol};
     }
 
@@ -169,35 +167,18 @@ Token Lexer::readStringLiteral(int startLine, int startCol) {
 }
 
 Token Lexer::readIdentifier(int startLine, int startCol) {
-    std::string value;
-
-    while (pos_ < source_.size()) {
-        const char c = source_[pos_];
-        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
-            value.push_back(c);
-            advance();
-        } else {
-            break;
-        }
+    std::size_t end = pos_;
+    while (end < source_.size() && hasClass(source_[end], kIdentChar)) {
+        end++;
     }
-
-    return {TokenType::Identifier, value, startLine, startCol};
+    return take(TokenType::Identifier, end - pos_, startLine, startCol);
 }
 
 Token Lexer::readNumber(int startLine, int startCol) {
-    std::string value;
-
-    // Обработка знака минус для отрицательных чисел
-    if (source_[pos_] == '-') {
-        value.push_back('-');
-        advance();
+    // Знак минус для отрицательных чисел
+    std::size_t end = source_[pos_] == '-' ? pos_ + 1 : pos_;
+    while (end < source_.size() && hasClass(source_[end], kDigit)) {
+        end++;
     }
-
-    // Считываем цифры
-    while (pos_ < source_.size() && std::isdigit(static_cast<unsigned char>(source_[pos_]))) {
-        value.push_back(source_[pos_]);
-        advance();
-    }
-
-    return {TokenType::Number, value, startLine, startCol};
+    return take(TokenType::Number, end - pos_, startLine, startCol);
 }
@@ -0,0 +1,376 @@
+#include "MachineImage.h"
+#include "Compiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using MachineImageFormat::ImageCell;
+using MachineImageFormat::ImageHeader;
+using MachineImageFormat::ImageRule;
+using MachineImageFormat::ImageSourceLine;
+using MachineImageFormat::ImageSymbol;
+using MachineImageFormat::kNoSymbol;
+
+namespace {
+
+constexpr std::uint64_t kAlignment = 8;
+
+std::uint64_t alignUp(std::uint64_t offset) {
+    return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+/** @brief Секция count записей по смещению offset целиком внутри файла */
+bool sectionFits(std::uint64_t offset, std::uint64_t count, std::uint64_t recordSize, std::uint64_t fileSize) {
+    if (offset % kAlignment != 0 || offset > fileSize) return false;
+    return count <= (fileSize - offset) / recordSize;
+}
+
+ImageTransition toImageTransition(const ImageRule& rule) {
+    return {rule.nextState, rule.writeSymbol, static_cast<Move>(rule.move)};
+}
+
+} // namespace
+
+bool writeMachineImage(const CompileResult& result, const std::filesystem::path& path) {
+    const TransitionTable& table = result.table;
+
+    // Символы: алфавит и всё, что встречается в таблице и на ленте
+    std::vector<Symbol> names = result.alphabet;
+    names.push_back(result.initialTape.blank());
+    StateId maxState = std::max(table.startState, table.haltState);
+    table.forEach([&](StateId state, const Symbol& symbol, const Transition& t) {
+        names.push_back(symbol);
+        names.push_back(t.writeSymbol);
+        maxState = std::max({maxState, state, t.nextState});
+    });
+    table.forEachDefault([&](StateId state, const Transition& t) {
+        names.push_back(t.writeSymbol);
+        maxState = std::max({maxState, state, t.nextState});
+    });
+    for (const auto& [member, rep] : table.symbolClasses()) {
+        names.push_back(member);
+        names.push_back(rep);
+    }
+    std::vector<std::pair<long long, Symbol>> cells;
+    result.initialTape.forEachCell([&](long long pos, const Symbol& sym) {
+        cells.emplace_back(pos, sym);
+        names.push_back(sym);
+    });
+    names.erase(std::remove(names.begin(), names.end(), kKeepSymbol), names.end());
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    std::sort(cells.begin(), cells.end());
+
+    if (maxState < 0) return false;
+    auto idOf = [&](const Symbol& sym) -> std::uint32_t {
+        if (sym == kKeepSymbol) return MachineImageFormat::kKeepSymbol;
+        return static_cast<std::uint32_t>(std::lower_bound(names.begin(), names.end(), sym) - names.begin());
+    };
+    auto toRule = [&](std::uint32_t symbol, const Transition& t) {
+        return ImageRule{symbol, t.nextState, idOf(t.writeSymbol), static_cast<std::uint32_t>(t.move)};
+    };
+
+    const std::uint32_t stateCount = static_cast<std::uint32_t>(maxState) + 1;
+    std::vector<std::pair<StateId, ImageRule>> rules;
+    table.forEach([&](StateId state, const Symbol& symbol, const Transition& t) {
+        rules.emplace_back(state, toRule(idOf(symbol), t));
+    });
+    std::sort(rules.begin(), rules.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first < b.first : a.second.symbol < b.second.symbol;
+    });
+    std::vector<std::uint32_t> rows(stateCount + 1, 0);
+    for (const auto& [state, rule] : rules) {
+        rows[state + 1]++;
+    }
+    for (std::uint32_t s = 0; s < stateCount; s++) {
+        rows[s + 1] += rows[s];
+    }
+    std::vector<ImageRule> defaults(stateCount, ImageRule{kNoSymbol, 0, kNoSymbol, static_cast<std::uint32_t>(Move::Stay)});
+    table.forEachDefault([&](StateId state, const Transition& t) {
+        defaults[state] = toRule(0, t);
+    });
+
+    std::vector<ImageSymbol> symbols;
+    std::string strings;
+    for (const auto& name : names) {
+        symbols.push_back({static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(name.size()),
+                           idOf(table.representative(name)), 0});
+        strings += name;
+    }
+    std::vector<ImageCell> tape;
+    for (const auto& [pos, sym] : cells) {
+        tape.push_back({pos, idOf(sym), 0});
+    }
+    std::vector<ImageSourceLine> sourceLines;
+    table.forEachSourceLine([&](StateId first, int line) { sourceLines.push_back({first, line}); });
+
+    ImageHeader header{};
+    std::memcpy(header.magic, MachineImageFormat::kMagic, sizeof MachineImageFormat::kMagic);
+    header.version = MachineImageFormat::kVersion;
+    header.headerSize = sizeof(ImageHeader);
+    header.byteOrder = MachineImageFormat::kByteOrderMark;
+    header.stateCount = stateCount;
+    header.symbolCount = static_cast<std::uint32_t>(symbols.size());
+    header.ruleCount = static_cast<std::uint32_t>(rules.size());
+    header.startState = table.startState;
+    header.haltState = table.haltState;
+    header.blankSymbol = idOf(result.initialTape.blank());
+    header.tapeCellCount = static_cast<std::uint32_t>(tape.size());
+    header.sourceLineCount = static_cast<std::uint32_t>(sourceLines.size());
+
+    // Раскладка секций подряд с выравниванием
+    std::uint64_t offset = alignUp(sizeof(ImageHeader));
+    auto place = [&offset](std::uint64_t& field, std::uint64_t bytes) {
+        field = offset;
+        offset = alignUp(offset + bytes);
+    };
+    place(header.symbolsOffset, symbols.size() * sizeof(ImageSymbol));
+    place(header.rowsOffset, rows.size() * sizeof(std::uint32_t));
+    place(header.rulesOffset, rules.size() * sizeof(ImageRule));
+    place(header.defaultsOffset, defaults.size() * sizeof(ImageRule));
+    place(header.tapeOffset, tape.size() * sizeof(ImageCell));
+    place(header.sourceLinesOffset, sourceLines.size() * sizeof(ImageSourceLine));
+    place(header.stringsOffset, strings.size());
+    header.stringBytes = strings.size();
+
+    std::string image(static_cast<std::size_t>(offset), '\0');
+    auto put = [&image](std::uint64_t at, const void* data, std::size_t bytes) {
+        if (bytes > 0) std::memcpy(&image[static_cast<std::size_t>(at)], data, bytes);
+    };
+    put(0, &header, sizeof header);
+    put(header.symbolsOffset, symbols.data(), symbols.size() * sizeof(ImageSymbol));
+    put(header.rowsOffset, rows.data(), rows.size() * sizeof(std::uint32_t));
+    for (std::size_t i = 0; i < rules.size(); i++) {
+        put(header.rulesOffset + i * sizeof(ImageRule), &rules[i].second, sizeof(ImageRule));
+    }
+    put(header.defaultsOffset, defaults.data(), defaults.size() * sizeof(ImageRule));
+    put(header.tapeOffset, tape.data(), tape.size() * sizeof(ImageCell));
+    put(header.sourceLinesOffset, sourceLines.data(), sourceLines.size() * sizeof(ImageSourceLine));
+    put(header.stringsOffset, strings.data(), strings.size());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(image.data(), static_cast<std::streamsize>(image.size()));
+    return static_cast<bool>(file);
+}
+
+MachineImage::~MachineImage() {
+    close();
+}
+
+bool MachineImage::open(const std::filesystem::path& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(ImageHeader))) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const unsigned char*>(view);
+    size_ = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ImageHeader))) {
+        ::close(fd);
+        return false;
+    }
+    // MAP_SHARED: страницы файла общие для всех процессов, открывших образ
+    void* view = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    data_ = static_cast<const unsigned char*>(view);
+    size_ = static_cast<std::size_t>(st.st_size);
+#endif
+
+    // Только заголовок и границы секций - содержимое не читается
+    const auto* header = reinterpret_cast<const ImageHeader*>(data_);
+    const std::uint64_t size = size_;
+    const bool valid =
+        std::memcmp(header->magic, MachineImageFormat::kMagic, sizeof MachineImageFormat::kMagic) == 0 &&
+        header->version == MachineImageFormat::kVersion &&
+        header->headerSize == sizeof(ImageHeader) &&
+        header->byteOrder == MachineImageFormat::kByteOrderMark &&
+        header->stateCount > 0 &&
+        header->startState >= 0 && static_cast<std::uint32_t>(header->startState) < header->stateCount &&
+        sectionFits(header->symbolsOffset, header->symbolCount, sizeof(ImageSymbol), size) &&
+        sectionFits(header->rowsOffset, std::uint64_t{header->stateCount} + 1, sizeof(std::uint32_t), size) &&
+        sectionFits(header->rulesOffset, header->ruleCount, sizeof(ImageRule), size) &&
+        sectionFits(header->defaultsOffset, header->stateCount, sizeof(ImageRule), size) &&
+        sectionFits(header->tapeOffset, header->tapeCellCount, sizeof(ImageCell), size) &&
+        sectionFits(header->sourceLinesOffset, header->sourceLineCount, sizeof(ImageSourceLine), size) &&
+        sectionFits(header->stringsOffset, header->stringBytes, 1, size);
+    if (!valid) {
+        close();
+        return false;
+    }
+    header_ = header;
+    return true;
+}
+
+void MachineImage::close() {
+    if (!data_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+    CloseHandle(static_cast<HANDLE>(file_));
+    mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+}
+
+std::string_view MachineImage::symbolName(std::uint32_t symbol) const {
+    if (symbol >= header_->symbolCount) return {};
+    const ImageSymbol& entry = section<ImageSymbol>(header_->symbolsOffset)[symbol];
+    if (entry.nameOffset > header_->stringBytes || entry.nameLength > header_->stringBytes - entry.nameOffset) {
+        return {};
+    }
+    return {section<char>(header_->stringsOffset) + entry.nameOffset, entry.nameLength};
+}
+
+std::uint32_t MachineImage::findSymbol(std::string_view name) const {
+    std::uint32_t lo = 0;
+    std::uint32_t hi = header_->symbolCount;
+    while (lo < hi) {
+        const std::uint32_t mid = lo + (hi - lo) / 2;
+        if (symbolName(mid) < name) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < header_->symbolCount && symbolName(lo) == name) ? lo : kNoSymbol;
+}
+
+const ImageRule* MachineImage::findRule(StateId state, std::uint32_t symbol) const {
+    const std::uint32_t* rows = section<std::uint32_t>(header_->rowsOffset);
+    const std::uint32_t begin = rows[state];
+    const std::uint32_t end = rows[state + 1];
+    if (begin > end || end > header_->ruleCount) return nullptr;
+
+    const ImageRule* rules = section<ImageRule>(header_->rulesOffset);
+    const ImageRule* it = std::lower_bound(rules + begin, rules + end, symbol,
+                                           [](const ImageRule& rule, std::uint32_t s) { return rule.symbol < s; });
+    return (it != rules + end && it->symbol == symbol) ? it : nullptr;
+}
+
+bool MachineImage::lookup(StateId state, std::uint32_t symbol, ImageTransition& out) const {
+    if (state < 0 || static_cast<std::uint32_t>(state) >= header_->stateCount) {
+        return false;
+    }
+    const ImageRule* rule = findRule(state, symbol);
+    std::uint32_t keep = MachineImageFormat::kKeepSymbol;
+    if (!rule && symbol < header_->symbolCount) {
+        // Правило представителя класса; оставить представителя - оставить сам символ
+        const std::uint32_t rep = section<ImageSymbol>(header_->symbolsOffset)[symbol].representative;
+        if (rep != symbol) {
+            rule = findRule(state, rep);
+            keep = rep;
+        }
+    }
+    if (!rule) {
+        rule = &section<ImageRule>(header_->defaultsOffset)[state];
+        if (rule->symbol == kNoSymbol) return false;
+    }
+    if (rule->move > static_cast<std::uint32_t>(Move::Stay)) {
+        return false;
+    }
+    out = toImageTransition(*rule);
+    if (out.writeSymbol == keep || out.writeSymbol == MachineImageFormat::kKeepSymbol) {
+        out.writeSymbol = symbol;
+    }
+    return true;
+}
+
+int MachineImage::sourceLine(StateId state) const {
+    const ImageSourceLine* lines = section<ImageSourceLine>(header_->sourceLinesOffset);
+    const ImageSourceLine* end = lines + header_->sourceLineCount;
+    const ImageSourceLine* it = std::upper_bound(lines, end, state,
+                                                 [](StateId s, const ImageSourceLine& l) { return s < l.firstState; });
+    return it == lines ? 0 : std::prev(it)->line;
+}
+
+Tape MachineImage::initialTape() const {
+    Tape tape{Symbol(symbolName(header_->blankSymbol))};
+    const ImageCell* cells = section<ImageCell>(header_->tapeOffset);
+    for (std::uint32_t i = 0; i < header_->tapeCellCount; i++) {
+        tape.set(cells[i].position, Symbol(symbolName(cells[i].symbol)));
+    }
+    return tape;
+}
+
+TransitionTable MachineImage::toTable() const {
+    TransitionTable table;
+    table.startState = header_->startState;
+    table.haltState = header_->haltState;
+
+    const ImageSymbol* symbols = section<ImageSymbol>(header_->symbolsOffset);
+    std::unordered_map<Symbol, Symbol> classes;
+    for (std::uint32_t i = 0; i < header_->symbolCount; i++) {
+        if (symbols[i].representative != i) {
+            classes[Symbol(symbolName(i))] = Symbol(symbolName(symbols[i].representative));
+        }
+    }
+    table.setSymbolClasses(std::move(classes));
+
+    auto toTransition = [&](const ImageRule& rule) {
+        const Symbol write = rule.writeSymbol == MachineImageFormat::kKeepSymbol
+                                 ? kKeepSymbol
+                                 : Symbol(symbolName(rule.writeSymbol));
+        return Transition{rule.nextState, write, static_cast<Move>(rule.move)};
+    };
+    const std::uint32_t* rows = section<std::uint32_t>(header_->rowsOffset);
+    const ImageRule* rules = section<ImageRule>(header_->rulesOffset);
+    const ImageRule* defaults = section<ImageRule>(header_->defaultsOffset);
+    for (std::uint32_t state = 0; state < header_->stateCount; state++) {
+        const std::uint32_t end = std::min(rows[state + 1], header_->ruleCount);
+        for (std::uint32_t i = rows[state]; i < end; i++) {
+            table.set(static_cast<StateId>(state), Symbol(symbolName(rules[i].symbol)), toTransition(rules[i]));
+        }
+        if (defaults[state].symbol != kNoSymbol) {
+            table.setDefault(static_cast<StateId>(state), toTransition(defaults[state]));
+        }
+    }
+
+    const ImageSourceLine* lines = section<ImageSourceLine>(header_->sourceLinesOffset);
+    for (std::uint32_t i = 0; i < header_->sourceLineCount; i++) {
+        table.setSourceLine(lines[i].firstState, lines[i].line);
+    }
+    return table;
+}
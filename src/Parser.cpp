@@ -0,0 +1,532 @@
+#include "Parser.h"
+#include "Condition.h"
+#include "MemoryLayout.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Проверяет, является ли символ зарезервированным системным символом.
+ * Зарезервированы: blank, BOM, EOM, 0_, 1_, #
+ */
+bool isReservedSystemSymbol(const std::string& sym) {
+    return sym == "blank" ||
+           sym == MemoryLayout::kSymBOM ||
+           sym == MemoryLayout::kSymEOM ||
+           sym == MemoryLayout::kBit0 ||
+           sym == MemoryLayout::kBit1 ||
+           sym == MemoryLayout::kPosMarker;
+}
+
+/** @brief Команды, допустимые в теле процедуры */
+bool isStatementKeyword(std::string_view cmd) {
+    return cmd == "move_left" || cmd == "move_right" || cmd == "write" || cmd == "call" ||
+           cmd == "if" || cmd == "while" || cmd == "x";
+}
+
+/** @brief Имена процедур, вызываемых из блока */
+void collectCalls(const IRBlock& block, std::vector<std::string>& calls) {
+    for (const auto& instr : block) {
+        if (instr->type == IRType::Call) {
+            calls.push_back(instr->argument);
+        }
+        collectCalls(instr->thenBranch, calls);
+        collectCalls(instr->elseBranch, calls);
+    }
+}
+
+/** @brief Слова строки, разделённые пробельными символами (срезы str, без копирования) */
+std::vector<std::string_view> splitBySpaces(std::string_view str) {
+    constexpr std::string_view kSpaces = " \t\n\v\f\r";
+    std::vector<std::string_view> tokens;
+    std::size_t pos = str.find_first_not_of(kSpaces);
+    while (pos != std::string_view::npos) {
+        const std::size_t end = std::min(str.find_first_of(kSpaces, pos), str.size());
+        tokens.push_back(str.substr(pos, end - pos));
+        pos = str.find_first_not_of(kSpaces, end);
+    }
+    return tokens;
+}
+
+} // namespace
+
+Parser::Parser(std::string_view source, IRArena& arena, CompileResult& result, CompileCache* cache,
+               CompileProgress* progress)
+    : source_(source)
+    , lexer_(source)
+    , compileArena_(arena)
+    , arena_(&arena)
+    , result_(result)
+    , cache_(cache)
+    , progress_(progress) {
+    alphabetSet_.insert(blankSymbol_);
+    result_.alphabet.push_back(blankSymbol_);
+    token_ = lexer_.next();
+}
+
+void Parser::error(int line, int col, const std::string& msg) {
+    result_.ok = false;
+    result_.diagnostics.push_back({DiagnosticLevel::Error, line, col, msg});
+}
+
+bool Parser::expect(TokenType expected, const std::string& what) {
+    if (token_.type != expected) {
+        error(token_.line, token_.column, "Ожидался " + what);
+        return false;
+    }
+    return true;
+}
+
+bool Parser::cancelled() {
+    if (!progress_ || !progress_->cancelled()) {
+        return false;
+    }
+    error(token_.line, token_.column, "Компиляция отменена");
+    return true;
+}
+
+void Parser::parse() {
+    while (token_.type != TokenType::Eof && result_.ok) {
+        if (progress_) {
+            progress_->report(CompilePhase::Parsing, lexer_.position(), source_.size());
+        }
+        if (cancelled()) break;
+        if (token_.type == TokenType::Identifier) {
+            const std::string_view cmd = token_.value;
+            const int cmdLine = token_.line;
+            const int cmdCol = token_.column;
+
+            if (cmd == "Set_alphabet") {
+                parseSetAlphabet(cmdLine, cmdCol);
+            } else if (cmd == "Setup") {
+                parseSetup(cmdLine, cmdCol);
+            } else if (cmd == "proc") {
+                parseProcHeader(cmdLine, cmdCol);
+            } else if (isStatementKeyword(cmd)) {
+                if (!alphabetDefined_) {
+                    error(cmdLine, cmdCol, std::string(cmd) + ": сначала нужно определить Set_alphabet");
+                    break;
+                }
+                IRBlock parsed;
+                if (!parseStatement(parsed, nullptr, 0)) break;
+                if (!currentProc_) {
+                    error(cmdLine, cmdCol, "Инструкция вне процедуры");
+                    break;
+                }
+                currentProc_->body.insert(currentProc_->body.end(), parsed.begin(), parsed.end());
+            } else {
+                error(cmdLine, cmdCol, "Неизвестная команда: '" + std::string(cmd) + "'");
+            }
+        } else if (token_.type == TokenType::RBrace) {
+            // Закрывающая скобка: конец тела процедуры
+            if (!currentProc_) {
+                error(token_.line, token_.column, "Неожиданная '}'");
+                break;
+            }
+            if (pending_) {
+                finishCachedBody();
+            }
+            currentProc_ = nullptr;
+            advance();
+        } else if (token_.type == TokenType::Unknown) {
+            // Неизвестный символ - ошибка лексера
+            error(token_.line, token_.column, "Неожиданный символ: '" + std::string(token_.value) + "'");
+        } else {
+            // Ожидали команду, но получили что-то другое
+            error(token_.line, token_.column, "Ожидалась команда");
+        }
+    }
+
+    // Наличие незакрытой процедуры
+    if (result_.ok && currentProc_) {
+        error(currentProc_->line, currentProc_->column,
+              "Процедура '" + currentProc_->name + "' не закрыта (отсутствует '}')");
+    }
+}
+
+// Set_alphabet "символы"; - алфавит ленты
+void Parser::parseSetAlphabet(int line, int col) {
+    if (currentProc_) {
+        error(line, col, "Set_alphabet не может быть внутри процедуры");
+        return;
+    }
+    if (setupDefined_) {
+        error(line, col, "Set_alphabet должен быть перед Setup");
+        return;
+    }
+    if (alphabetDefined_) {
+        error(line, col, "Set_alphabet уже был определён (повторный вызов запрещён)");
+        return;
+    }
+    if (!procedures_.empty()) {
+        error(line, col, "Set_alphabet должен быть перед определением процедур");
+        return;
+    }
+
+    // Аргумент - строка с символами алфавита
+    advance();
+    if (!expect(TokenType::StringLiteral, "строка с алфавитом")) return;
+
+    const std::string_view content = token_.value;
+    const int strLine = token_.line;
+    const int strCol = token_.column;
+
+    advance();
+    if (!expect(TokenType::Semicolon, ";")) return;
+
+    // Разбиваем строку по пробелам и добавляем символы в алфавит
+    for (const std::string_view word : splitBySpaces(content)) {
+        const Symbol sym(word);
+        if (isReservedSystemSymbol(sym)) {
+            error(strLine, strCol, "Имя '" + sym + "' зарезервировано и не может использоваться в алфавите");
+            return;
+        }
+        if (alphabetSet_.count(sym)) {
+            error(strLine, strCol, "Дублирующийся символ в алфавите: '" + sym + "'");
+            return;
+        }
+        alphabetSet_.insert(sym);
+        result_.alphabet.push_back(sym);
+    }
+
+    alphabetDefined_ = true;
+    if (cache_) {
+        cache_->useAlphabet(result_.alphabet);
+    }
+
+    // Системные символы добавляются сразу после алфавита,
+    // чтобы write "0_"/"1_" работало и символы отображались в таблице переходов
+    for (const Symbol& sym : {MemoryLayout::kSymBOM, MemoryLayout::kSymEOM, MemoryLayout::kBit0,
+                              MemoryLayout::kBit1, MemoryLayout::kPosMarker}) {
+        if (alphabetSet_.insert(sym).second) {
+            result_.alphabet.push_back(sym);
+        }
+    }
+
+    advance();
+}
+
+// Setup "содержимое ленты"; - начальное содержимое ленты
+void Parser::parseSetup(int line, int col) {
+    if (currentProc_) {
+        error(line, col, "Setup не может быть внутри процедуры");
+        return;
+    }
+    if (!alphabetDefined_) {
+        error(line, col, "Setup должен быть после Set_alphabet");
+        return;
+    }
+    if (setupDefined_) {
+        error(line, col, "Setup уже был определён (повторный вызов запрещён)");
+        return;
+    }
+    if (!procedures_.empty()) {
+        error(line, col, "Setup должен быть перед определением процедур");
+        return;
+    }
+
+    advance();
+    if (!expect(TokenType::StringLiteral, "строка с начальным содержимым ленты")) return;
+
+    const std::string_view content = token_.value;
+    const int strLine = token_.line;
+    const int strCol = token_.column;
+
+    advance();
+    if (!expect(TokenType::Semicolon, ";")) return;
+
+    long long pos = 0;
+    for (const std::string_view sym : splitBySpaces(content)) {
+        Symbol actualSym = (sym == "blank") ? blankSymbol_ : Symbol(sym);
+        if (actualSym != blankSymbol_ && !alphabetSet_.count(actualSym)) {
+            error(strLine, strCol, "Символ '" + std::string(sym) + "' не определён в алфавите");
+            return;
+        }
+        result_.initialTape.set(pos, actualSym);
+        pos++;
+    }
+
+    setupDefined_ = true;
+    advance();
+}
+
+// proc имя() { - начало определения процедуры; тело разбирает parse()
+void Parser::parseProcHeader(int line, int col) {
+    if (currentProc_) {
+        error(line, col, "Вложенные процедуры не поддерживаются");
+        return;
+    }
+    if (!alphabetDefined_) {
+        error(line, col, "proc: сначала нужно определить Set_alphabet");
+        return;
+    }
+
+    const Token procToken = token_;
+    advance();
+    if (!expect(TokenType::Identifier, "имя процедуры")) return;
+
+    const std::string procName(token_.value);
+    if (procedures_.count(procName)) {
+        error(token_.line, token_.column, "Процедура '" + procName + "' уже определена");
+        return;
+    }
+
+    advance();
+    if (!expect(TokenType::LParen, "(")) return;
+    advance();
+    if (!expect(TokenType::RParen, ")")) return;
+    advance();
+    if (!expect(TokenType::LBrace, "{")) return;
+
+    // Процедура видна до конца своего тела: рекурсию обнаружит flatten
+    Procedure& proc = procedures_[procName];
+    proc.name = procName;
+    proc.line = line;
+    proc.column = col;
+    currentProc_ = &proc;
+    if (cache_) {
+        beginCachedBody(procToken);
+    }
+    advance();
+}
+
+void Parser::beginCachedBody(const Token& procToken) {
+    // Конец тела - парная '}'; копия лексера не сдвигает разбор
+    Lexer scan = lexer_;
+    Token last;
+    int depth = 1;
+    do {
+        last = scan.next();
+        if (last.type == TokenType::LBrace) depth++;
+        if (last.type == TokenType::RBrace) depth--;
+    } while (depth > 0 && last.type != TokenType::Eof);
+    if (depth > 0) return;  // Незакрытое тело: ошибку сообщит разбор
+
+    const std::size_t start = static_cast<std::size_t>(procToken.value.data() - source_.data());
+    const std::size_t end = static_cast<std::size_t>(last.value.data() - source_.data()) + 1;
+    const std::string_view text = source_.substr(start, end - start);
+
+    CachedProcedure* entry = cache_->findProcedure(text, currentProc_->line, currentProc_->column);
+    bool callsDefined = entry != nullptr;
+    if (entry) {
+        for (const auto& callee : entry->calls) {
+            callsDefined = callsDefined && procedures_.count(callee) > 0;
+        }
+    }
+
+    if (callsDefined) {
+        entry->used = true;
+        currentProc_->body = entry->procedure.body;
+        currentProc_ = nullptr;
+        lexer_ = scan;
+        token_ = last;
+        cache_->reusedProcedures++;
+        return;
+    }
+
+    // Тело разбирается в арену записи: узлы переживут эту компиляцию
+    pending_ = std::make_unique<CachedProcedure>();
+    pending_->arena = std::make_unique<IRArena>();
+    pending_->text = std::string(text);
+    arena_ = pending_->arena.get();
+    cache_->parsedProcedures++;
+}
+
+void Parser::finishCachedBody() {
+    pending_->procedure = *currentProc_;
+    collectCalls(currentProc_->body, pending_->calls);
+    pending_->used = true;
+    cache_->storeProcedure(std::move(pending_));
+    arena_ = &compileArena_;
+}
+
+bool Parser::parseStatement(IRBlock& out, const char* context, int depth) {
+    const std::string_view cmd = token_.value;
+    const int line = token_.line;
+    const int col = token_.column;
+
+    if (cmd == "move_left" || cmd == "move_right") {
+        advance();
+        if (!expect(TokenType::Semicolon, ";")) return false;
+        const IRType type = cmd == "move_left" ? IRType::MoveLeft : IRType::MoveRight;
+        out.push_back(IRInstruction::simple(*arena_, type, "", line, col));
+        advance();
+        return true;
+    }
+
+    if (cmd == "write") {
+        advance();
+        if (!expect(TokenType::StringLiteral, "символ для записи")) return false;
+        Symbol sym;
+        if (!parseSymbol(sym)) return false;
+        advance();
+        if (!expect(TokenType::Semicolon, ";")) return false;
+        out.push_back(IRInstruction::simple(*arena_, IRType::Write, sym, line, col));
+        advance();
+        return true;
+    }
+
+    if (cmd == "call") {
+        advance();
+        if (!expect(TokenType::Identifier, "имя процедуры")) return false;
+        const std::string procName(token_.value);
+        if (!procedures_.count(procName)) {
+            error(token_.line, token_.column, "Процедура '" + procName + "' не определена");
+            return false;
+        }
+        advance();
+        if (!expect(TokenType::Semicolon, ";")) return false;
+        out.push_back(IRInstruction::simple(*arena_, IRType::Call, procName, line, col));
+        advance();
+        return true;
+    }
+
+    IRInstruction* instr = nullptr;
+    if (cmd == "if") {
+        instr = parseIf(line, col, depth);
+    } else if (cmd == "while") {
+        instr = parseWhile(line, col, depth);
+    } else if (cmd == "x") {
+        instr = parseVarOp(line, col);
+    } else if (context) {
+        error(line, col, "Неизвестная команда внутри " + std::string(context) + ": '" + std::string(cmd) + "'");
+    } else {
+        error(line, col, "Неизвестная команда: '" + std::string(cmd) + "'");
+    }
+    if (!instr) return false;
+    out.push_back(instr);
+    return true;
+}
+
+bool Parser::parseBlock(IRBlock& out, const char* context, int depth) {
+    if (depth > kMaxNestingDepth) {
+        error(token_.line, token_.column,
+              "Слишком глубокая вложенность блоков (больше " + std::to_string(kMaxNestingDepth) + ")");
+        return false;
+    }
+    while (result_.ok && token_.type != TokenType::Eof) {
+        if (token_.type == TokenType::RBrace) {
+            advance();
+            return true;
+        }
+        if (token_.type != TokenType::Identifier) {
+            error(token_.line, token_.column, "Ожидалась команда или '}'");
+            return false;
+        }
+        if (cancelled() || !parseStatement(out, context, depth)) return false;
+    }
+    // Конец файла внутри блока: о незакрытой процедуре сообщит parse()
+    return result_.ok;
+}
+
+ConditionPtr Parser::parseHeader() {
+    advance();
+    if (!expect(TokenType::LParen, "(")) return nullptr;
+    advance();
+
+    ConditionParser conditionParser(lexer_, token_, alphabetSet_, blankSymbol_, *arena_,
+                                    result_.diagnostics, result_.ok);
+    ConditionPtr cond = conditionParser.parse();
+    if (!cond || !result_.ok) return nullptr;
+
+    if (!expect(TokenType::RParen, ")")) return nullptr;
+    advance();
+    if (!expect(TokenType::LBrace, "{")) return nullptr;
+    advance();
+    return cond;
+}
+
+// if (условие) { ... } [else if (условие) { ... }]* [else { ... }]
+IRInstruction* Parser::parseIf(int line, int col, int depth) {
+    ConditionPtr cond = parseHeader();
+    if (!cond) return nullptr;
+
+    IRInstruction* head = IRInstruction::ifElse(*arena_, cond, {}, {}, line, col);
+    if (!parseBlock(head->thenBranch, "if", depth + 1)) return nullptr;
+
+    // else if - if в else-ветке предыдущего звена. Цепочка разбирается циклом,
+    // но каждое звено - уровень вложенности IR, поэтому считается в глубину
+    IRInstruction* last = head;
+    int lastDepth = depth + 1;
+    while (token_.type == TokenType::Identifier && token_.value == "else") {
+        advance();
+        if (token_.type == TokenType::Identifier && token_.value == "if") {
+            const int elseIfLine = token_.line;
+            const int elseIfCol = token_.column;
+            ConditionPtr elseIfCond = parseHeader();
+            if (!elseIfCond) return nullptr;
+
+            IRInstruction* elseIf = IRInstruction::ifElse(*arena_, elseIfCond, {}, {}, elseIfLine, elseIfCol);
+            last->elseBranch.push_back(elseIf);
+            last = elseIf;
+            if (!parseBlock(elseIf->thenBranch, "else if", ++lastDepth)) return nullptr;
+        } else if (token_.type == TokenType::LBrace) {
+            advance();
+            if (!parseBlock(last->elseBranch, "else", lastDepth)) return nullptr;
+            break;
+        } else {
+            error(token_.line, token_.column, "После 'else' ожидалась '{' или 'if'");
+            return nullptr;
+        }
+    }
+    return head;
+}
+
+// while (условие) { ... }
+IRInstruction* Parser::parseWhile(int line, int col, int depth) {
+    ConditionPtr cond = parseHeader();
+    if (!cond) return nullptr;
+
+    IRInstruction* loop = IRInstruction::whileLoop(*arena_, cond, {}, line, col);
+    if (!parseBlock(loop->thenBranch, "while", depth + 1)) return nullptr;
+    return loop;
+}
+
+// x = <число>; x++; x--;
+IRInstruction* Parser::parseVarOp(int line, int col) {
+    advance();
+
+    if (token_.type == TokenType::Assign) {
+        advance();
+        if (token_.type != TokenType::Number) {
+            error(token_.line, token_.column, "После 'x =' ожидалось число");
+            return nullptr;
+        }
+        int value = 0;
+        if (!parseNumber(token_.value, value)) {
+            error(token_.line, token_.column, "Некорректное число: '" + std::string(token_.value) + "'");
+            return nullptr;
+        }
+        if (value < -128 || value > 127) {
+            error(token_.line, token_.column, "Значение должно быть в диапазоне [-128..127]");
+            return nullptr;
+        }
+        advance();
+        if (!expect(TokenType::Semicolon, ";")) return nullptr;
+        advance();
+        return IRInstruction::varSetConst(*arena_, value, line, col);
+    }
+
+    if (token_.type == TokenType::PlusPlus || token_.type == TokenType::MinusMinus) {
+        const bool increment = token_.type == TokenType::PlusPlus;
+        advance();
+        if (!expect(TokenType::Semicolon, ";")) return nullptr;
+        advance();
+        return increment ? IRInstruction::varInc(*arena_, line, col) : IRInstruction::varDec(*arena_, line, col);
+    }
+
+    error(token_.line, token_.column, "После 'x' ожидалось '=', '++' или '--'");
+    return nullptr;
+}
+
+bool Parser::parseSymbol(Symbol& out) {
+    const std::string symStr(token_.value);
+    out = (symStr == "blank") ? blankSymbol_ : symStr;
+    if (out != blankSymbol_ && !alphabetSet_.count(out)) {
+        error(token_.line, token_.column, "Символ '" + symStr + "' не определён в алфавите");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,225 @@
+#include "TableOptimizer.h"
+#include "MemoryLayout.h"
+
+#include <array>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Пройти цепочку Stay-переходов от folded
+ *
+ * Цепочка заканчивается движением, остановом или отсутствием правила.
+ * @return false, если цепочка зацикливается - такое правило оставляем как есть
+ */
+bool followStayChain(const TransitionTable& table, Transition& folded) {
+    std::set<std::pair<StateId, Symbol>> visited;
+    while (folded.move == Move::Stay && folded.nextState != table.haltState) {
+        // Символ не известен: правило по умолчанию, оставляющее символ
+        if (folded.writeSymbol == kKeepSymbol) {
+            break;
+        }
+        // Правило представителя действует за весь класс, а у членов класса
+        // здесь могут быть свои правила - дальше сворачивать нельзя
+        if (table.isClassRepresentative(folded.writeSymbol) &&
+            table.hasMemberRules(folded.nextState)) {
+            break;
+        }
+        Transition next;
+        if (!table.lookup(folded.nextState, folded.writeSymbol, next)) {
+            break;
+        }
+        if (!visited.insert({folded.nextState, folded.writeSymbol}).second) {
+            return false;
+        }
+        folded = next;
+    }
+    return true;
+}
+
+bool changed(const Transition& a, const Transition& b) {
+    return a.nextState != b.nextState || a.move != b.move || a.writeSymbol != b.writeSymbol;
+}
+
+} // namespace
+
+std::size_t foldStayTransitions(TransitionTable& table) {
+    struct Update {
+        StateId state;
+        Symbol symbol;
+        Transition transition;
+    };
+    std::vector<Update> updates;
+    std::vector<std::pair<StateId, Transition>> defaultUpdates;
+
+    table.forEach([&](StateId state, const Symbol& symbol, const Transition& tr) {
+        if (tr.move != Move::Stay || tr.nextState == table.haltState) {
+            return;
+        }
+        Transition folded = tr;
+        if (followStayChain(table, folded) && changed(folded, tr)) {
+            updates.push_back({state, symbol, folded});
+        }
+    });
+    // Правило по умолчанию сворачивается, только если оно пишет конкретный символ
+    table.forEachDefault([&](StateId state, const Transition& tr) {
+        if (tr.move != Move::Stay || tr.nextState == table.haltState ||
+            tr.writeSymbol == kKeepSymbol) {
+            return;
+        }
+        Transition folded = tr;
+        if (followStayChain(table, folded) && changed(folded, tr)) {
+            defaultUpdates.push_back({state, folded});
+        }
+    });
+
+    for (const auto& u : updates) {
+        table.set(u.state, u.symbol, u.transition);
+    }
+    for (const auto& [state, tr] : defaultUpdates) {
+        table.setDefault(state, tr);
+    }
+    return updates.size() + defaultUpdates.size();
+}
+
+std::size_t removeUnreachableStates(TransitionTable& table) {
+    std::unordered_map<StateId, std::vector<StateId>> successors;
+    table.forEach([&](StateId state, const Symbol&, const Transition& tr) {
+        successors[state].push_back(tr.nextState);
+    });
+    table.forEachDefault([&](StateId state, const Transition& tr) {
+        successors[state].push_back(tr.nextState);
+    });
+
+    std::unordered_set<StateId> reachable{table.startState};
+    std::vector<StateId> work{table.startState};
+    while (!work.empty()) {
+        StateId s = work.back();
+        work.pop_back();
+        auto it = successors.find(s);
+        if (it == successors.end()) {
+            continue;
+        }
+        for (StateId next : it->second) {
+            if (reachable.insert(next).second) {
+                work.push_back(next);
+            }
+        }
+    }
+
+    return table.eraseStates([&](StateId s) { return !reachable.count(s); });
+}
+
+namespace {
+
+// Абстрактные позиции головки: левее памяти, клетки памяти BOM..EOM, пользовательская зона
+constexpr int kLeftZone = 0;
+constexpr int kRightZone = MemoryLayout::kMemEnd - MemoryLayout::kMemBegin + 2;
+constexpr int kPositions = kRightZone + 1;
+
+int abstractPosition(long long position) {
+    if (position < MemoryLayout::kMemBegin) return kLeftZone;
+    if (position > MemoryLayout::kMemEnd) return kRightZone;
+    return static_cast<int>(position - MemoryLayout::kMemBegin) + 1;
+}
+
+/** @brief Куда может попасть головка после сдвига */
+std::vector<int> movedPositions(int position, Move move) {
+    if (move == Move::Stay) return {position};
+    if (move == Move::Left) {
+        if (position == kRightZone) return {kRightZone, kRightZone - 1};
+        if (position == kLeftZone) return {kLeftZone};
+        return {position - 1};
+    }
+    if (position == kLeftZone) return {kLeftZone, kLeftZone + 1};
+    if (position == kRightZone) return {kRightZone};
+    return {position + 1};
+}
+
+} // namespace
+
+std::size_t removeImpossibleTransitions(TransitionTable& table, const Tape& initialTape,
+                                        const std::vector<Symbol>& tapeSymbols,
+                                        const CompileProgress* progress) {
+    // Что может лежать в каждой абстрактной позиции
+    std::array<std::set<Symbol>, kPositions> cells;
+    cells[kLeftZone].insert(initialTape.blank());
+    cells[kRightZone].insert(initialTape.blank());
+    cells[kRightZone].insert(tapeSymbols.begin(), tapeSymbols.end());
+    const auto bounds = initialTape.bounds(0);
+    for (long long p = bounds.first; p <= bounds.second; p++) {
+        cells[abstractPosition(p)].insert(initialTape.get(p));
+    }
+
+    // Факт: в состоянии головка в позиции position над symbol
+    using Fact = std::pair<int, Symbol>;
+    std::unordered_map<StateId, std::set<Fact>> facts;
+    std::vector<std::pair<StateId, Fact>> work;
+    auto addFact = [&](StateId state, int position, const Symbol& symbol) {
+        if (facts[state].insert({position, symbol}).second) {
+            work.push_back({state, {position, symbol}});
+        }
+    };
+
+    // Старт на позиции 0 - любой символ пользовательской зоны
+    for (const auto& sym : cells[kRightZone]) {
+        addFact(table.startState, kRightZone, sym);
+    }
+
+    std::set<std::pair<StateId, Symbol>> firedRules;
+    std::unordered_set<StateId> firedDefaults;
+    bool cellsGrew = true;
+    while (cellsGrew) {
+        cellsGrew = false;
+        while (!work.empty()) {
+            if (progress && progress->cancelled()) {
+                return 0;
+            }
+            auto [state, fact] = work.back();
+            work.pop_back();
+            const auto& [position, symbol] = fact;
+
+            Transition tr;
+            if (state == table.haltState || !table.lookup(state, symbol, tr)) {
+                continue;
+            }
+            const Symbol& rep = table.representative(symbol);
+            if (table.get(state, symbol)) {
+                firedRules.insert({state, symbol});
+            } else if (rep != symbol && table.get(state, rep)) {
+                firedRules.insert({state, rep});
+            } else {
+                firedDefaults.insert(state);
+            }
+
+            // Записанный символ потом прочтут, вернувшись в эту клетку
+            cellsGrew = cells[position].insert(tr.writeSymbol).second || cellsGrew;
+            if (tr.move == Move::Stay) {
+                addFact(tr.nextState, position, tr.writeSymbol);
+                continue;
+            }
+            for (int next : movedPositions(position, tr.move)) {
+                for (const auto& sym : cells[next]) {
+                    addFact(tr.nextState, next, sym);
+                }
+            }
+        }
+        // Клетка пополнилась - факты после сдвигов в неё пересчитываем заново
+        if (cellsGrew) {
+            for (const auto& [state, stateFacts] : facts) {
+                for (const auto& fact : stateFacts) {
+                    work.push_back({state, fact});
+                }
+            }
+        }
+    }
+
+    return table.eraseRules([&](StateId state, const Symbol& symbol) {
+               return !firedRules.count({state, symbol});
+           }) +
+           table.eraseDefaults([&](StateId state) { return !firedDefaults.count(state); });
+}
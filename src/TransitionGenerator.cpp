@@ -1,50 +1,126 @@
 #include "TransitionGenerator.h"
 #include "CodegenPrimitives.h"
+#include "IRAnalysis.h"
 #include "MemoryLayout.h"
 
+#include <algorithm>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
 using namespace MemoryLayout;
 
 namespace {
 
 
-// Смещение для L
-StateId g_phaseOffset = 0;
+/** @brief Уже сгенерированный хвост блока: block[from..] с выходом в exit */
+struct SharedTail {
+    const IRBlock* block;
+    std::size_t from;
+    StateId exit;
+    StateId entry;
+};
+
+/** @brief Инструкция, переходы которой ещё не сгенерированы (ленивый режим) */
+struct DeferredInstruction {
+    const IRInstruction* instr;
+    StateId end;        // Конец диапазона состояний инструкции
+    StateId next;       // Куда переходить после неё
+    bool phaseR;
+};
+
+/**
+ * @brief Состояние одной кодогенерации
+ *
+ * Передаётся явно во все функции генерации - несколько программ можно
+ * компилировать одновременно из разных потоков.
+ */
+struct GenContext {
+    CodegenOptions options;                 // Текущие настройки кодогенерации
+    VarAccess access;                       // Как операции с переменной добираются до памяти
+    StateId phaseOffset = 0;                // Смещение для L
+    bool singlePhase = false;               // Головка не пересекает память - генерируется только фаза R
+    std::vector<Symbol> classMembers;       // Символы, правила которых берутся у представителя класса
+
+    // Входы инструкций, куда головка может попасть сразу после пересечения памяти
+    std::set<StateId> boundaryTargets;
+    // Хвосты по хешу (хвост + выход); одинаковый код с тем же выходом генерируется один раз
+    std::unordered_multimap<std::size_t, SharedTail> tails;
+    // Хеши инструкций (вложенные блоки хешируются много раз)
+    std::unordered_map<const IRInstruction*, std::size_t> instrHashes;
+
+    CompileProgress* progress = nullptr;    // Ход и отмена (nullptr - не отслеживаются)
+    StateId phaseStates = 0;                // Состояний в одной фазе
+
+    // Ленивый режим: инструкции блоков не генерируются, а откладываются по началу диапазона
+    std::map<StateId, DeferredInstruction>* deferred = nullptr;
+};
 
 bool isSystemSymbol(const Symbol& sym) {
     return sym == kSymBOM || sym == kSymEOM || sym == kBit0 || sym == kBit1;
 }
 
 
+// Условие без сравнений x зависит только от символа под головкой
+bool isReadOnlyCondition(const GenContext& gen, const ConditionPtr& cond) {
+    return gen.options.compileReadConditions && !containsVarCondition(cond);
+}
+
+/**
+ * @brief Порядок проверки операндов And/Or/Xor
+ *
+ * Сравнения x не двигают головку в итоге, поэтому операнды можно переставлять.
+ * В And/Or дешёвую проверку символа ставим первой - она может отсечь сравнение.
+ * В Xor правый операнд дублируется, поэтому туда уходит проверка символа.
+ */
+std::pair<ConditionPtr, ConditionPtr> orderedOperands(const GenContext& gen, const ConditionPtr& cond) {
+    const bool leftRead = isReadOnlyCondition(gen, cond->left);
+    const bool rightRead = isReadOnlyCondition(gen, cond->right);
+    const bool swap = (cond->type == ConditionType::Xor) ? (leftRead && !rightRead)
+                                                         : (!leftRead && rightRead);
+    if (swap) {
+        return {cond->right, cond->left};
+    }
+    return {cond->left, cond->right};
+}
+
 // Рекурсивно считаем количество состояний
-StateId countConditionStates(const ConditionPtr& cond, const std::vector<Symbol>& alphabet) {
+StateId countConditionStates(const GenContext& gen, const ConditionPtr& cond, const std::vector<Symbol>& alphabet) {
     if (!cond) return 1;
+    if (isReadOnlyCondition(gen, cond)) return 1;
     
     switch (cond->type) {
     case ConditionType::VarLtConst:
-        return countCmpInt8States(alphabet, cond->intValue);
+        return countCmpInt8States(alphabet, cond->intValue, gen.access);
     
     case ConditionType::VarGtConst:
-        return countCmpInt8States(alphabet, cond->intValue);
+        return countCmpInt8States(alphabet, cond->intValue, gen.access);
         
     case ConditionType::ReadEq:
     case ConditionType::ReadNeq:
         return 1;
         
     case ConditionType::And:
-        return countConditionStates(cond->left, alphabet) + 
-               countConditionStates(cond->right, alphabet);
+        return countConditionStates(gen, cond->left, alphabet) + 
+               countConditionStates(gen, cond->right, alphabet);
         
     case ConditionType::Or:
-        return countConditionStates(cond->left, alphabet) + 
-               countConditionStates(cond->right, alphabet);
+        return countConditionStates(gen, cond->left, alphabet) + 
+               countConditionStates(gen, cond->right, alphabet);
         
-    case ConditionType::Xor:
-        return countConditionStates(cond->left, alphabet) + 
-               countConditionStates(cond->right, alphabet) * 2;
+    case ConditionType::Xor: {
+        auto [left, right] = orderedOperands(gen, cond);
+        return countConditionStates(gen, left, alphabet) + 
+               countConditionStates(gen, right, alphabet) * 2;
+    }
         
     case ConditionType::Not:
         // Просто инвертируем результат - то же количество состояний
-        return countConditionStates(cond->operand, alphabet);
+        return countConditionStates(gen, cond->operand, alphabet);
     }
     return 1;
 }
@@ -53,6 +129,7 @@ StateId countConditionStates(const ConditionPtr& cond, const std::vector<Symbol>
 // Генерация переходов для состовных условий
 
 StateId generateConditionTransitions(
+    GenContext& gen,
     const ConditionPtr& cond,
     const std::vector<Symbol>& alphabet,
     TransitionTable& table,
@@ -61,6 +138,22 @@ StateId generateConditionTransitions(
     StateId elseState,
     CodegenContext& ctx);
 
+// Условие без переменной: одно состояние, ветка выбирается по символу
+StateId generateTruthTableCondition(
+    const ConditionPtr& cond,
+    const std::vector<Symbol>& alphabet,
+    TransitionTable& table,
+    StateId currentState,
+    StateId thenState,
+    StateId elseState
+) {
+    for (const auto& sym : alphabet) {
+        StateId target = evaluateCondition(cond, sym) ? thenState : elseState;
+        table.add(currentState, sym, {target, sym, Move::Stay});
+    }
+    return currentState + 1;
+}
+
 // ReadEq/ReadNeq
 StateId generateReadCondition(
     const ConditionPtr& cond,
@@ -85,6 +178,7 @@ StateId generateReadCondition(
 
 // Проверка условий
 StateId generateConditionTransitions(
+    GenContext& gen,
     const ConditionPtr& cond,
     const std::vector<Symbol>& alphabet,
     TransitionTable& table,
@@ -100,18 +194,25 @@ StateId generateConditionTransitions(
         }
         return startState + 1;
     }
+    if (isReadOnlyCondition(gen, cond)) {
+        return generateTruthTableCondition(cond, alphabet, table, startState, thenState, elseState);
+    }
     
     switch (cond->type) {
     case ConditionType::VarLtConst: {
         // Уже есть для x < N
+        // Внутренние состояния - строго внутри своего диапазона, иначе в and/or
+        // правое сравнение залезет на вход следующего узла
+        ctx.nextState = startState + 1;
         genCmpInt8Const_LT(ctx, startState, thenState, elseState, cond->intValue);
-        return startState + countCmpInt8States(alphabet, cond->intValue);
+        return startState + countCmpInt8States(alphabet, cond->intValue, gen.access);
     }
     
     case ConditionType::VarGtConst: {
         // Уже есть для x > N
+        ctx.nextState = startState + 1;
         genCmpInt8Const_GT(ctx, startState, thenState, elseState, cond->intValue);
-        return startState + countCmpInt8States(alphabet, cond->intValue);
+        return startState + countCmpInt8States(alphabet, cond->intValue, gen.access);
     }
     
     case ConditionType::ReadEq:
@@ -120,49 +221,52 @@ StateId generateConditionTransitions(
     
     case ConditionType::And: {
         // AND
-        StateId leftStates = countConditionStates(cond->left, alphabet);
+        auto [left, right] = orderedOperands(gen, cond);
+        StateId leftStates = countConditionStates(gen, left, alphabet);
         StateId rightStart = startState + leftStates;
         
         // Левое условие
-        generateConditionTransitions(cond->left, alphabet, table, startState, rightStart, elseState, ctx);
+        generateConditionTransitions(gen, left, alphabet, table, startState, rightStart, elseState, ctx);
         
         // Правое условие
-        return generateConditionTransitions(cond->right, alphabet, table, rightStart, thenState, elseState, ctx);
+        return generateConditionTransitions(gen, right, alphabet, table, rightStart, thenState, elseState, ctx);
     }
     
     case ConditionType::Or: {
         // OR
-        StateId leftStates = countConditionStates(cond->left, alphabet);
+        auto [left, right] = orderedOperands(gen, cond);
+        StateId leftStates = countConditionStates(gen, left, alphabet);
         StateId rightStart = startState + leftStates;
         
         // Левое условие
-        generateConditionTransitions(cond->left, alphabet, table, startState, thenState, rightStart, ctx);
+        generateConditionTransitions(gen, left, alphabet, table, startState, thenState, rightStart, ctx);
         
         // Правое условие
-        return generateConditionTransitions(cond->right, alphabet, table, rightStart, thenState, elseState, ctx);
+        return generateConditionTransitions(gen, right, alphabet, table, rightStart, thenState, elseState, ctx);
     }
     
     case ConditionType::Xor: {
         // XOR
-        StateId leftStates = countConditionStates(cond->left, alphabet);
-        StateId rightStates = countConditionStates(cond->right, alphabet);
+        auto [left, right] = orderedOperands(gen, cond);
+        StateId leftStates = countConditionStates(gen, left, alphabet);
+        StateId rightStates = countConditionStates(gen, right, alphabet);
         
         StateId rightIfLeftTrue = startState + leftStates;
         StateId rightIfLeftFalse = rightIfLeftTrue + rightStates;
         
         // Левое условие
-        generateConditionTransitions(cond->left, alphabet, table, startState, rightIfLeftTrue, rightIfLeftFalse, ctx);
+        generateConditionTransitions(gen, left, alphabet, table, startState, rightIfLeftTrue, rightIfLeftFalse, ctx);
         
         // Левое оказалось true
-        generateConditionTransitions(cond->right, alphabet, table, rightIfLeftTrue, elseState, thenState, ctx);
+        generateConditionTransitions(gen, right, alphabet, table, rightIfLeftTrue, elseState, thenState, ctx);
         
         // Левое оказалось false
-        return generateConditionTransitions(cond->right, alphabet, table, rightIfLeftFalse, thenState, elseState, ctx);
+        return generateConditionTransitions(gen, right, alphabet, table, rightIfLeftFalse, thenState, elseState, ctx);
     }
     
     case ConditionType::Not:
         // NOT - просто меняем then и else местами
-        return generateConditionTransitions(cond->operand, alphabet, table, startState, elseState, thenState, ctx);
+        return generateConditionTransitions(gen, cond->operand, alphabet, table, startState, elseState, thenState, ctx);
     }
     
     return startState + 1;
@@ -173,49 +277,123 @@ StateId generateConditionTransitions(
 
 constexpr StateId kSkipMemoryStates = 10;
 
-StateId countStates(const IRBlock& block, const std::vector<Symbol>& alphabet);
+/**
+ * @brief while (<условие по символу>) { move_left/move_right; }
+ *
+ * Такой цикл - одно состояние, шагающее само в себя: шаг ленты на клетку.
+ * Пересечение памяти обрабатывает вход состояния (mergeBoundaryChecks),
+ * поэтому без этой стратегии и при памяти у головки цикл не сворачивается.
+ */
+bool isScanLoop(const GenContext& gen, const IRInstruction& instr) {
+    return gen.options.lowerScanLoops && gen.options.mergeBoundaryChecks &&
+           !gen.access.memoryFollowsHead && instr.type == IRType::While &&
+           instr.condition && !containsVarCondition(instr.condition) &&
+           instr.thenBranch.size() == 1 &&
+           (instr.thenBranch[0]->type == IRType::MoveLeft ||
+            instr.thenBranch[0]->type == IRType::MoveRight);
+}
+
+/**
+ * @brief Цепочка if / else if по символу под головкой
+ *
+ * conditions[i] выбирает arms[i], последняя ветка - финальный else.
+ */
+struct DispatchChain {
+    std::vector<ConditionPtr> conditions;
+    std::vector<const IRBlock*> arms;
+};
+
+/**
+ * @brief Разобрать if / else if из двух и более условий без x
+ *
+ * Все условия вычисляются по одному и тому же символу, поэтому цепочка
+ * превращается в одно состояние с переходом сразу в нужную ветку.
+ */
+bool collectDispatchChain(const GenContext& gen, const IRInstruction& instr, DispatchChain& chain) {
+    auto isReadIf = [](const IRInstruction& node) {
+        return node.type == IRType::IfElse && node.condition &&
+               !containsVarCondition(node.condition);
+    };
+    if (!gen.options.dispatchElseIfChains || !gen.options.compileReadConditions || !isReadIf(instr)) {
+        return false;
+    }
+
+    const IRInstruction* node = &instr;
+    while (true) {
+        chain.conditions.push_back(node->condition);
+        chain.arms.push_back(&node->thenBranch);
+        const IRBlock& rest = node->elseBranch;
+        if (rest.size() == 1 && isReadIf(*rest[0])) {
+            node = rest[0];
+            continue;
+        }
+        chain.arms.push_back(&rest);
+        break;
+    }
+    return chain.conditions.size() >= 2;
+}
 
-StateId countInstructionStates(const std::shared_ptr<IRInstruction>& instr, const std::vector<Symbol>& alphabet) {
+StateId countStates(const GenContext& gen, const IRBlock& block, const std::vector<Symbol>& alphabet);
+
+StateId countInstructionStates(const GenContext& gen, const IRInstruction* instr, const std::vector<Symbol>& alphabet) {
+    if (gen.access.memoryFollowsHead && instr->type == IRType::MoveLeft) {
+        return countShiftMemoryLeftStates(alphabet);
+    }
+    if (gen.access.memoryFollowsHead && instr->type == IRType::MoveRight) {
+        return countShiftMemoryRightStates(alphabet);
+    }
     if (instr->type == IRType::MoveLeft || instr->type == IRType::MoveRight) {
         return 2 + kSkipMemoryStates;
     }
     
+    DispatchChain chain;
+    if (instr->type == IRType::IfElse && collectDispatchChain(gen, *instr, chain)) {
+        StateId states = 1;
+        for (const IRBlock* arm : chain.arms) {
+            states += countStates(gen, *arm, alphabet);
+        }
+        return states;
+    }
     if (instr->type == IRType::IfElse) {
-        StateId thenStates = countStates(instr->thenBranch, alphabet);
-        StateId elseStates = countStates(instr->elseBranch, alphabet);
+        StateId thenStates = countStates(gen, instr->thenBranch, alphabet);
+        StateId elseStates = countStates(gen, instr->elseBranch, alphabet);
         
-        StateId condStates = countConditionStates(instr->condition, alphabet);
+        StateId condStates = countConditionStates(gen, instr->condition, alphabet);
         return thenStates + elseStates + condStates;
     }
+    if (isScanLoop(gen, *instr)) {
+        return 1;
+    }
     if (instr->type == IRType::While) {
-        StateId bodyStates = countStates(instr->thenBranch, alphabet);
+        StateId bodyStates = countStates(gen, instr->thenBranch, alphabet);
         
-        StateId condStates = countConditionStates(instr->condition, alphabet);
+        StateId condStates = countConditionStates(gen, instr->condition, alphabet);
         return bodyStates + condStates;
     }
     
     if (instr->type == IRType::VarSetConst) {
-        return countVarSetConstStates(alphabet);
+        return countVarSetConstStates(alphabet, gen.access);
     }
     if (instr->type == IRType::VarInc) {
-        return countVarIncStates(alphabet);
+        return countVarIncStates(alphabet, gen.access);
     }
     if (instr->type == IRType::VarDec) {
-        return countVarDecStates(alphabet);
+        return countVarDecStates(alphabet, gen.access);
     }
     
     return 1;
 }
 
-StateId countStates(const IRBlock& block, const std::vector<Symbol>& alphabet) {
+StateId countStates(const GenContext& gen, const IRBlock& block, const std::vector<Symbol>& alphabet) {
     StateId count = 0;
     for (const auto& instr : block) {
-        count += countInstructionStates(instr, alphabet);
+        count += countInstructionStates(gen, instr, alphabet);
     }
     return count;
 }
 
 StateId generateBlockTransitions(
+    GenContext& gen,
     const IRBlock& block,
     const std::vector<Symbol>& alphabet,
     TransitionTable& table,
@@ -223,8 +401,64 @@ StateId generateBlockTransitions(
     StateId exitState,
     bool phaseR);
 
+std::size_t cachedInstructionHash(GenContext& gen, const IRInstruction& instr) {
+    auto it = gen.instrHashes.find(&instr);
+    if (it != gen.instrHashes.end()) return it->second;
+    const std::size_t h = hashInstruction(instr);
+    gen.instrHashes.emplace(&instr, h);
+    return h;
+}
+
+// Хеши хвостов block[i..]; последний элемент - пустой хвост
+std::vector<std::size_t> tailHashes(GenContext& gen, const IRBlock& block) {
+    std::vector<std::size_t> hashes(block.size() + 1, 0);
+    for (std::size_t i = block.size(); i-- > 0;) {
+        hashes[i] = hashCombine(cachedInstructionHash(gen, *block[i]), hashes[i + 1]);
+    }
+    return hashes;
+}
+
+bool sameTail(const IRBlock& a, std::size_t fromA, const IRBlock& b, std::size_t fromB) {
+    if (a.size() - fromA != b.size() - fromB) return false;
+    for (std::size_t i = 0; fromA + i < a.size(); i++) {
+        const auto& x = a[fromA + i];
+        const auto& y = b[fromB + i];
+        if (x != y && !sameInstruction(*x, *y)) return false;
+    }
+    return true;
+}
+
+/** @brief Вход уже сгенерированного такого же хвоста (0 - не найден) */
+StateId findTail(const GenContext& gen, const IRBlock& block, std::size_t from, std::size_t hash, StateId exit) {
+    if (!gen.options.shareIdenticalTails) return 0;
+    auto range = gen.tails.equal_range(hashCombine(hash, exit));
+    for (auto it = range.first; it != range.second; ++it) {
+        const SharedTail& t = it->second;
+        if (t.exit == exit && sameTail(*t.block, t.from, block, from)) {
+            return t.entry;
+        }
+    }
+    return 0;
+}
+
+void rememberTail(GenContext& gen, const IRBlock& block, std::size_t from, std::size_t hash, StateId exit, StateId entry) {
+    if (!gen.options.shareIdenticalTails) return;
+    gen.tails.emplace(hashCombine(hash, exit), SharedTail{&block, from, exit, entry});
+}
+
+/**
+ * @brief Вход ветки: start или вход такой же, уже сгенерированной ветки
+ *
+ * Если возвращён не start, генерировать ветку не нужно - её состояния
+ * останутся без переходов.
+ */
+StateId blockEntry(GenContext& gen, const IRBlock& block, StateId start, StateId exit) {
+    if (block.empty() || !gen.options.shareIdenticalTails) return start;
+    const StateId shared = findTail(gen, block, 0, tailHashes(gen, block)[0], exit);
+    return shared ? shared : start;
+}
+
 StateId generateSkipMemoryLeft(
-    const std::vector<Symbol>& alphabet,
     TransitionTable& table,
     StateId startState,
     StateId exitStateL
@@ -232,21 +466,16 @@ StateId generateSkipMemoryLeft(
     StateId s = startState;
     for (int i = 0; i < 9; i++) {
         StateId nextS = s + 1;
-        for (const auto& sym : alphabet) {
-            table.add(s, sym, {nextS, sym, Move::Left});
-        }
+        table.setDefault(s, {nextS, kKeepSymbol, Move::Left});
         s = nextS;
     }
     
     // Последний шаг влево - переходим в фазу L
-    for (const auto& sym : alphabet) {
-        table.add(s, sym, {exitStateL, sym, Move::Left});
-    }
+    table.setDefault(s, {exitStateL, kKeepSymbol, Move::Left});
     return s + 1;
 }
 
 StateId generateSkipMemoryRight(
-    const std::vector<Symbol>& alphabet,
     TransitionTable& table,
     StateId startState,
     StateId exitStateR
@@ -254,38 +483,84 @@ StateId generateSkipMemoryRight(
     StateId s = startState;
     for (int i = 0; i < 9; i++) {
         StateId nextS = s + 1;
-        for (const auto& sym : alphabet) {
-            table.add(s, sym, {nextS, sym, Move::Right});
-        }
+        table.setDefault(s, {nextS, kKeepSymbol, Move::Right});
         s = nextS;
     }
     // Последний шаг вправо - переходим в фазу R
-    for (const auto& sym : alphabet) {
-        table.add(s, sym, {exitStateR, sym, Move::Right});
-    }
+    table.setDefault(s, {exitStateR, kKeepSymbol, Move::Right});
+    return s + 1;
+}
+
+/**
+ * @brief Обработка границы памяти во входе инструкции
+ *
+ * В фазе R на EOM (в фазе L на BOM) вход сразу начинает обход памяти и
+ * через kSkipMemoryStates шагов попадает во вход той же инструкции другой фазы.
+ */
+StateId generateEntrySkip(
+    const GenContext& gen,
+    TransitionTable& table,
+    StateId entry,
+    StateId chainStart
+) {
+    const bool phaseR = entry < gen.phaseOffset;
+    const Symbol& boundary = phaseR ? kSymEOM : kSymBOM;
+    const Move dir = phaseR ? Move::Left : Move::Right;
+    const StateId twin = phaseR ? entry + gen.phaseOffset : entry - gen.phaseOffset;
+
+    StateId s = chainStart;
+    table.set(entry, boundary, {s, boundary, dir});
+    for (int i = 0; i < kSkipMemoryStates - 2; i++) {
+        table.setDefault(s, {s + 1, kKeepSymbol, dir});
+        s++;
+    }
+    table.setDefault(s, {twin, kKeepSymbol, dir});
     return s + 1;
 }
 
 StateId generateInstructionTransitions(
-    const std::shared_ptr<IRInstruction>& instr,
+    GenContext& gen,
+    const IRInstruction* instr,
     const std::vector<Symbol>& alphabet,
     TransitionTable& table,
     StateId currentState,
     StateId nextState,
     bool phaseR
 ) {
-    StateId nextStateR = phaseR ? nextState : (nextState - g_phaseOffset);
-    StateId nextStateL = phaseR ? (nextState + g_phaseOffset) : nextState;
+    StateId nextStateR = phaseR ? nextState : (nextState - gen.phaseOffset);
+    StateId nextStateL = phaseR ? (nextState + gen.phaseOffset) : nextState;
+
+    if (gen.access.memoryFollowsHead && (instr->type == IRType::MoveLeft || instr->type == IRType::MoveRight)) {
+        // Фаз нет: вместе с головкой сдвигаем блок памяти
+        CodegenContext ctx;
+        ctx.tt = &table;
+        ctx.nextState = currentState + 1;
+        ctx.alphabet = alphabet;
+        ctx.access = gen.access;
+        ctx.classMembers = gen.classMembers;
+
+        if (instr->type == IRType::MoveLeft) {
+            genShiftMemoryLeft(ctx, currentState, nextState);
+        } else {
+            genShiftMemoryRight(ctx, currentState, nextState);
+        }
+        return nextState;
+    }
     
     switch (instr->type) {
     case IRType::MoveLeft: {
         StateId afterMove = currentState + 1;
         StateId skipStart = currentState + 2;
         
-        if (phaseR) {
-            for (const auto& sym : alphabet) {
-                table.add(currentState, sym, {afterMove, sym, Move::Left});
-            }
+        // Проверку EOM выполнит вход следующей инструкции. Состояние останова
+        // переходов не имеет, поэтому перед ним оставляем afterMove.
+        if (phaseR && gen.singlePhase) {
+            table.setDefault(currentState, {nextStateR, kKeepSymbol, Move::Left});
+        } else if (phaseR && gen.options.mergeBoundaryChecks && nextStateR != gen.phaseOffset - 1) {
+            table.setDefault(currentState, {nextStateR, kKeepSymbol, Move::Left});
+            gen.boundaryTargets.insert(nextStateR);
+        } else if (phaseR) {
+            table.setDefault(currentState, {afterMove, kKeepSymbol, Move::Left});
             
             for (const auto& sym : alphabet) {
                 if (sym == kSymEOM) {
@@ -296,11 +571,9 @@ StateId generateInstructionTransitions(
                     table.add(afterMove, sym, {nextStateR, sym, Move::Stay});
                 }
             }
-            generateSkipMemoryLeft(alphabet, table, skipStart, nextStateL);
+            generateSkipMemoryLeft(table, skipStart, nextStateL);
         } else {
-            for (const auto& sym : alphabet) {
-                table.add(currentState, sym, {nextStateL, sym, Move::Left});
-            }
+            table.setDefault(currentState, {nextStateL, kKeepSymbol, Move::Left});
         }
         return skipStart + kSkipMemoryStates;
     }
@@ -310,13 +583,12 @@ StateId generateInstructionTransitions(
         StateId skipStart = currentState + 2;
         
         if (phaseR) {
-            for (const auto& sym : alphabet) {
-                table.add(currentState, sym, {nextStateR, sym, Move::Right});
-            }
+            table.setDefault(currentState, {nextStateR, kKeepSymbol, Move::Right});
+        } else if (gen.options.mergeBoundaryChecks) {
+            table.setDefault(currentState, {nextStateL, kKeepSymbol, Move::Right});
+            gen.boundaryTargets.insert(nextStateL);
         } else {
-            for (const auto& sym : alphabet) {
-                table.add(currentState, sym, {afterMove, sym, Move::Right});
-            }
+            table.setDefault(currentState, {afterMove, kKeepSymbol, Move::Right});
             
             for (const auto& sym : alphabet) {
                 if (sym == kSymBOM) {
@@ -327,15 +599,13 @@ StateId generateInstructionTransitions(
                     table.add(afterMove, sym, {nextStateL, sym, Move::Stay});
                 }
             }
-            generateSkipMemoryRight(alphabet, table, skipStart, nextStateR);
+            generateSkipMemoryRight(table, skipStart, nextStateR);
         }
         return skipStart + kSkipMemoryStates;
     }
 
     case IRType::Write:
-        for (const auto& sym : alphabet) {
-            table.add(currentState, sym, {nextState, instr->argument, Move::Stay});
-        }
+        table.setDefault(currentState, {nextState, instr->argument, Move::Stay});
         return nextState;
 
     case IRType::Call:
@@ -347,6 +617,8 @@ StateId generateInstructionTransitions(
         ctx.nextState = currentState + 1;
         ctx.alphabet = alphabet;
         ctx.phaseR = phaseR;
+        ctx.access = gen.access;
+        ctx.classMembers = gen.classMembers;
         
         genSetInt8Const(ctx, currentState, nextState, instr->intValue);
         return nextState;
@@ -358,6 +630,8 @@ StateId generateInstructionTransitions(
         ctx.nextState = currentState + 1;
         ctx.alphabet = alphabet;
         ctx.phaseR = phaseR;
+        ctx.access = gen.access;
+        ctx.classMembers = gen.classMembers;
         
         genIncInt8(ctx, currentState, nextState);
         return nextState;
@@ -369,57 +643,105 @@ StateId generateInstructionTransitions(
         ctx.nextState = currentState + 1;
         ctx.alphabet = alphabet;
         ctx.phaseR = phaseR;
+        ctx.access = gen.access;
+        ctx.classMembers = gen.classMembers;
         
         genDecInt8(ctx, currentState, nextState);
         return nextState;
     }
 
     case IRType::IfElse: {
-        StateId thenStates = countStates(instr->thenBranch, alphabet);
-        StateId elseStates = countStates(instr->elseBranch, alphabet);
-        StateId condStates = countConditionStates(instr->condition, alphabet);
+        DispatchChain chain;
+        if (collectDispatchChain(gen, *instr, chain)) {
+            // Ветки подряд за состоянием выбора
+            std::vector<StateId> targets;
+            StateId armStart = currentState + 1;
+            for (const IRBlock* arm : chain.arms) {
+                StateId armStates = countStates(gen, *arm, alphabet);
+                StateId target = (armStates > 0) ? blockEntry(gen, *arm, armStart, nextState) : nextState;
+                targets.push_back(target);
+                if (armStates > 0 && target == armStart) {
+                    generateBlockTransitions(gen, *arm, alphabet, table, armStart, nextState, phaseR);
+                }
+                armStart += armStates;
+            }
+            for (const auto& sym : alphabet) {
+                std::size_t taken = 0;
+                while (taken < chain.conditions.size() &&
+                       !evaluateCondition(chain.conditions[taken], sym)) {
+                    taken++;
+                }
+                table.add(currentState, sym, {targets[taken], sym, Move::Stay});
+            }
+            return armStart;
+        }
+
+        StateId thenStates = countStates(gen, instr->thenBranch, alphabet);
+        StateId elseStates = countStates(gen, instr->elseBranch, alphabet);
+        StateId condStates = countConditionStates(gen, instr->condition, alphabet);
 
         StateId thenStart = currentState + condStates;
         StateId elseStart = thenStart + thenStates;
         
-        StateId thenTarget = (thenStates > 0) ? thenStart : nextState;
-        StateId elseTarget = (elseStates > 0) ? elseStart : nextState;
+        StateId thenTarget = (thenStates > 0) ? blockEntry(gen, instr->thenBranch, thenStart, nextState) : nextState;
+        StateId elseTarget = (elseStates > 0) ? blockEntry(gen, instr->elseBranch, elseStart, nextState) : nextState;
         
         CodegenContext ctx;
         ctx.tt = &table;
         ctx.nextState = currentState + 1;
         ctx.alphabet = alphabet;
         ctx.phaseR = phaseR;
+        ctx.access = gen.access;
+        ctx.classMembers = gen.classMembers;
         
-        generateConditionTransitions(instr->condition, alphabet, table, currentState, thenTarget, elseTarget, ctx);
+        generateConditionTransitions(gen, instr->condition, alphabet, table, currentState, thenTarget, elseTarget, ctx);
         
-        if (thenStates > 0) {
-            generateBlockTransitions(instr->thenBranch, alphabet, table, thenStart, nextState, phaseR);
+        if (thenStates > 0 && thenTarget == thenStart) {
+            generateBlockTransitions(gen, instr->thenBranch, alphabet, table, thenStart, nextState, phaseR);
         }
-        if (elseStates > 0) {
-            generateBlockTransitions(instr->elseBranch, alphabet, table, elseStart, nextState, phaseR);
+        if (elseStates > 0 && elseTarget == elseStart) {
+            generateBlockTransitions(gen, instr->elseBranch, alphabet, table, elseStart, nextState, phaseR);
         }
         
         return elseStart + elseStates;
     }
 
     case IRType::While: {
-        StateId bodyStates = countStates(instr->thenBranch, alphabet);
-        StateId condStates = countConditionStates(instr->condition, alphabet);
+        if (isScanLoop(gen, *instr)) {
+            const Move dir = (instr->thenBranch[0]->type == IRType::MoveLeft) ? Move::Left : Move::Right;
+            for (const auto& sym : alphabet) {
+                if (evaluateCondition(instr->condition, sym)) {
+                    table.add(currentState, sym, {currentState, sym, dir});
+                } else {
+                    table.add(currentState, sym, {nextState, sym, Move::Stay});
+                }
+            }
+            // Шаг на EOM (BOM) - обход памяти во входе этого же состояния
+            const bool towardMemory = phaseR ? (dir == Move::Left) : (dir == Move::Right);
+            if (towardMemory && !gen.singlePhase) {
+                gen.boundaryTargets.insert(currentState);
+            }
+            return nextState;
+        }
+
+        StateId bodyStates = countStates(gen, instr->thenBranch, alphabet);
+        StateId condStates = countConditionStates(gen, instr->condition, alphabet);
         
         StateId bodyStart = currentState + condStates;
-        StateId bodyTarget = (bodyStates > 0) ? bodyStart : currentState;
+        StateId bodyTarget = (bodyStates > 0) ? blockEntry(gen, instr->thenBranch, bodyStart, currentState) : currentState;
         
         CodegenContext ctx;
         ctx.tt = &table;
         ctx.nextState = currentState + 1;
         ctx.alphabet = alphabet;
         ctx.phaseR = phaseR;
+        ctx.access = gen.access;
+        ctx.classMembers = gen.classMembers;
         
-        generateConditionTransitions(instr->condition, alphabet, table, currentState, bodyTarget, nextState, ctx);
+        generateConditionTransitions(gen, instr->condition, alphabet, table, currentState, bodyTarget, nextState, ctx);
         
-        if (bodyStates > 0) {
-            generateBlockTransitions(instr->thenBranch, alphabet, table, bodyStart, currentState, phaseR);
+        if (bodyStates > 0 && bodyTarget == bodyStart) {
+            generateBlockTransitions(gen, instr->thenBranch, alphabet, table, bodyStart, currentState, phaseR);
         }
         
         return bodyStart + bodyStates;
@@ -429,6 +751,7 @@ StateId generateInstructionTransitions(
 }
 
 StateId generateBlockTransitions(
+    GenContext& gen,
     const IRBlock& block,
     const std::vector<Symbol>& alphabet,
     TransitionTable& table,
@@ -439,46 +762,262 @@ StateId generateBlockTransitions(
     if (block.empty()) {
         return startState;
     }
+    if (gen.deferred) {
+        // Только раскладка: переходы инструкции - при первом входе в её диапазон
+        StateId current = startState;
+        for (std::size_t i = 0; i < block.size(); i++) {
+            const StateId statesNeeded = countInstructionStates(gen, block[i], alphabet);
+            if (statesNeeded > 0) {
+                const StateId next = (i + 1 < block.size()) ? current + statesNeeded : exitState;
+                gen.deferred->insert_or_assign(current, DeferredInstruction{block[i], current + statesNeeded, next, phaseR});
+            }
+            current += statesNeeded;
+        }
+        return current;
+    }
 
+    const std::vector<std::size_t> hashes = gen.options.shareIdenticalTails
+                                            ? tailHashes(gen, block) : std::vector<std::size_t>(block.size() + 1, 0);
     StateId current = startState;
+    bool shared = false;
     for (std::size_t i = 0; i < block.size(); i++) {
         const auto& instr = block[i];
-        StateId statesNeeded = countInstructionStates(instr, alphabet);
-        StateId next = (i + 1 < block.size()) ? (current + statesNeeded) : exitState;
-        generateInstructionTransitions(instr, alphabet, table, current, next, phaseR);
+        StateId statesNeeded = countInstructionStates(gen, instr, alphabet);
+        if (shared) {
+            // Остаток блока уже есть - состояния зарезервированы, но не используются
+            current += statesNeeded;
+            continue;
+        }
+        if (gen.progress) {
+            if (gen.progress->cancelled()) return current;
+            if (phaseR) gen.progress->report(CompilePhase::Codegen, current, gen.phaseStates);
+        }
+        StateId next = exitState;
+        if (i + 1 < block.size()) {
+            const StateId tail = findTail(gen, block, i + 1, hashes[i + 1], exitState);
+            shared = tail != 0;
+            next = shared ? tail : current + statesNeeded;
+        }
+        table.setSourceLine(current, instr->line);
+        generateInstructionTransitions(gen, instr, alphabet, table, current, next, phaseR);
+        rememberTail(gen, block, i, hashes[i], exitState, current);
         current += statesNeeded;
     }
     return current;
 }
 
-} // namespace
-
-void generateTransitions(
+/**
+ * @brief Подготовка кодогенерации: классы символов, раскладка фаз, состояния останова
+ * @return Алфавит, для которого генерируются переходы (без членов классов)
+ */
+std::vector<Symbol> prepareGeneration(
+    GenContext& gen,
     const IRBlock& instructions,
-    const std::vector<Symbol>& alphabet,
-    TransitionTable& table
+    const std::vector<Symbol>& fullAlphabet,
+    TransitionTable& table,
+    const CodegenOptions& options
 ) {
-    StateId singlePhaseStates = countStates(instructions, alphabet);
-    
-    g_phaseOffset = singlePhaseStates + 1;
+    // Настройки влияют и на подсчёт состояний - выставляем до countStates
+    gen.options = options;
+    gen.access.memoryFollowsHead = options.memoryPlacement == Placement::FollowsHead;
+    gen.access.sharedMarkers = options.sharedMarkerChains && !gen.access.memoryFollowsHead;
+
+    // Неразличимые программой символы - один класс, переходы только для представителя.
+    // Символ под головкой должен пережить поход в память, поэтому нужны общие маркеры
+    std::vector<Symbol> genAlphabet = fullAlphabet;
+    if (options.symbolClasses && !gen.access.memoryFollowsHead &&
+        (gen.access.sharedMarkers || !usesVariable(instructions))) {
+        gen.classMembers = indistinguishableSymbols(instructions, fullAlphabet);
+    }
+    if (gen.classMembers.size() >= 2) {
+        const Symbol representative = gen.classMembers.front();
+        gen.classMembers.erase(gen.classMembers.begin());
+        std::unordered_map<Symbol, Symbol> classes;
+        for (const auto& sym : gen.classMembers) {
+            classes[sym] = representative;
+            genAlphabet.erase(std::find(genAlphabet.begin(), genAlphabet.end(), sym));
+        }
+        table.setSymbolClasses(std::move(classes));
+    } else {
+        gen.classMembers.clear();
+    }
+
+    StateId singlePhaseStates = countStates(gen, instructions, genAlphabet);
     
-    const StateId haltStateR = singlePhaseStates;
-    const StateId haltStateL = g_phaseOffset + singlePhaseStates;
+    gen.phaseOffset = singlePhaseStates + 1;
+    gen.phaseStates = singlePhaseStates;
 
     table.startState = 0;
-    table.haltState = haltStateR;
-
+    table.haltState = singlePhaseStates;
     if (instructions.empty()) {
-        table.startState = 0;
         table.haltState = 0;
+        return genAlphabet;
+    }
+
+    // Головка никогда не уходит левее старта: фаза L и обходы памяти не нужны
+    // То же при памяти рядом с головкой: граница памяти всегда позади
+    gen.singlePhase = gen.access.memoryFollowsHead ||
+                      (options.elideUnreachablePhase && headStaysInUserZone(instructions));
+    return genAlphabet;
+}
+
+} // namespace
+
+void generateTransitions(
+    const IRBlock& instructions,
+    const std::vector<Symbol>& fullAlphabet,
+    TransitionTable& table,
+    const CodegenOptions& options,
+    CompileProgress* progress
+) {
+    GenContext gen;
+    gen.progress = progress;
+    const std::vector<Symbol> alphabet = prepareGeneration(gen, instructions, fullAlphabet, table, options);
+    if (instructions.empty()) {
         return;
     }
+    const StateId haltStateR = table.haltState;
+    const StateId haltStateL = gen.phaseOffset + gen.phaseStates;
 
-    generateBlockTransitions(instructions, alphabet, table, 0, haltStateR, true);
-    
-    generateBlockTransitions(instructions, alphabet, table, g_phaseOffset, haltStateL, false);
-    
-    for (const auto& sym : alphabet) {
-        table.add(haltStateL, sym, {haltStateR, sym, Move::Stay});
+    // Останов и цепочки обхода памяти после фаз - служебные состояния без строки
+    table.setSourceLine(haltStateR, 0);
+    if (gen.singlePhase) {
+        generateBlockTransitions(gen, instructions, alphabet, table, 0, haltStateR, true);
+        return;
+    }
+    table.setSourceLine(haltStateL, 0);
+
+    // Фазы занимают непересекающиеся диапазоны состояний и не читают таблицу:
+    // у каждой свои кэши хвостов и своя часть таблицы, части потом сливаются.
+    // Копии делаются до генерации - в них только настройки и классы символов
+    GenContext genL = gen;
+    TransitionTable tableL = table;
+    auto generateL = [&] {
+        generateBlockTransitions(genL, instructions, alphabet, tableL, gen.phaseOffset, haltStateL, false);
+    };
+    if (options.parallelPhases) {
+        std::future<void> phaseL = std::async(std::launch::async, generateL);
+        generateBlockTransitions(gen, instructions, alphabet, table, 0, haltStateR, true);
+        phaseL.get();
+    } else {
+        generateBlockTransitions(gen, instructions, alphabet, table, 0, haltStateR, true);
+        generateL();
+    }
+    table.merge(std::move(tableL));
+    gen.boundaryTargets.insert(genL.boundaryTargets.begin(), genL.boundaryTargets.end());
+
+    table.setDefault(haltStateL, {haltStateR, kKeepSymbol, Move::Stay});
+
+    // Цепочки обхода памяти размещаем после обеих фаз
+    StateId chainState = haltStateL + 1;
+    for (StateId target : gen.boundaryTargets) {
+        chainState = generateEntrySkip(gen, table, target, chainState);
+    }
+}
+
+/** @brief Отложенные инструкции и уже сгенерированная часть таблицы */
+struct LazyTransitions::Generator {
+    std::unique_ptr<IRArena> arena;             // Узлы program
+    IRBlock program;
+    std::vector<Symbol> alphabet;               // Алфавит кодогенерации (без членов классов)
+    GenContext gen;
+    TransitionTable table;
+    std::map<StateId, DeferredInstruction> pending;
+    std::set<StateId> waitingTargets;           // Входы с обходом памяти, ещё не сгенерированные
+    StateId chainState = 0;                     // Следующее свободное состояние для цепочек обхода
+
+    /** @brief Отложенная инструкция, в диапазон которой попадает state */
+    std::map<StateId, DeferredInstruction>::iterator pendingAt(StateId state) {
+        auto it = pending.upper_bound(state);
+        if (it == pending.begin()) return pending.end();
+        --it;
+        return state < it->second.end ? it : pending.end();
+    }
+
+    /** @brief Генерировать инструкции, пока state не окажется вне отложенных */
+    void materialize(StateId state) {
+        for (auto it = pendingAt(state); it != pending.end(); it = pendingAt(state)) {
+            const StateId start = it->first;
+            const DeferredInstruction unit = it->second;
+            pending.erase(it);
+            table.setSourceLine(start, unit.instr->line);
+            // Вложенные блоки снова откладываются - в том числе тот, где лежит state
+            generateInstructionTransitions(gen, unit.instr, alphabet, table, start, unit.next, unit.phaseR);
+        }
+
+        // Цепочку обхода памяти входу ставим после его собственных переходов, как и без ленивости
+        waitingTargets.insert(gen.boundaryTargets.begin(), gen.boundaryTargets.end());
+        gen.boundaryTargets.clear();
+        for (auto it = waitingTargets.begin(); it != waitingTargets.end();) {
+            if (pendingAt(*it) != pending.end()) {
+                ++it;
+                continue;
+            }
+            chainState = generateEntrySkip(gen, table, *it, chainState);
+            it = waitingTargets.erase(it);
+        }
     }
+};
+
+LazyTransitions::LazyTransitions(
+    IRBlock instructions,
+    std::unique_ptr<IRArena> arena,
+    const std::vector<Symbol>& alphabet,
+    const CodegenOptions& options
+) : generator_(std::make_unique<Generator>()) {
+    Generator& g = *generator_;
+    g.arena = std::move(arena);
+    g.program = std::move(instructions);
+
+    // Поиск общих хвостов зависит от порядка генерации - в ленивом режиме его нет
+    CodegenOptions lazyOptions = options;
+    lazyOptions.shareIdenticalTails = false;
+    g.alphabet = prepareGeneration(g.gen, g.program, alphabet, g.table, lazyOptions);
+    if (g.program.empty()) {
+        return;
+    }
+    g.gen.deferred = &g.pending;
+
+    const StateId haltStateR = g.table.haltState;
+    g.table.setSourceLine(haltStateR, 0);
+    generateBlockTransitions(g.gen, g.program, g.alphabet, g.table, 0, haltStateR, true);
+    if (!g.gen.singlePhase) {
+        const StateId haltStateL = g.gen.phaseOffset + g.gen.phaseStates;
+        g.table.setSourceLine(haltStateL, 0);
+        generateBlockTransitions(g.gen, g.program, g.alphabet, g.table, g.gen.phaseOffset, haltStateL, false);
+        g.table.setDefault(haltStateL, {haltStateR, kKeepSymbol, Move::Stay});
+        g.chainState = haltStateL + 1;
+    }
+}
+
+LazyTransitions::~LazyTransitions() = default;
+
+StateId LazyTransitions::startState() const {
+    return generator_->table.startState;
+}
+
+StateId LazyTransitions::haltState() const {
+    return generator_->table.haltState;
+}
+
+bool LazyTransitions::lookup(StateId state, const Symbol& symbol, Transition& out) const {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (generator_->pendingAt(state) == generator_->pending.end()) {
+            return generator_->table.lookup(state, symbol, out);
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    generator_->materialize(state);
+    return generator_->table.lookup(state, symbol, out);
+}
+
+TransitionTable LazyTransitions::snapshot() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return generator_->table;
+}
+
+std::size_t LazyTransitions::pendingInstructions() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return generator_->pending.size();
 }
@@ -1,6 +1,7 @@
 #include "TransitionTable.h"
 
 #include <algorithm>
+#include <iterator>
 #include <utility>
 
 bool TransitionTable::add(StateId state, Symbol symbol, const Transition& transition) {
@@ -12,6 +13,9 @@ bool TransitionTable::add(StateId state, Symbol symbol, const Transition& transi
     if (!inserted) {
         return false;
     }
+    if (representatives_.count(symbol)) {
+        memberRuleStates_.insert(state);
+    }
     return true;
 }
 
@@ -29,6 +33,128 @@ const Transition* TransitionTable::get(StateId state, Symbol symbol) const {
     return &it->second;
 }
 
+bool TransitionTable::lookup(StateId state, const Symbol& symbol, Transition& out) const {
+    if (const Transition* own = get(state, symbol)) {
+        out = *own;
+        return true;
+    }
+    auto rep = representatives_.find(symbol);
+    if (rep != representatives_.end()) {
+        if (const Transition* shared = get(state, rep->second)) {
+            out = *shared;
+            if (out.writeSymbol == rep->second) {
+                out.writeSymbol = symbol;
+            }
+            return true;
+        }
+    }
+    const Transition* fallback = getDefault(state);
+    if (!fallback) {
+        return false;
+    }
+    out = *fallback;
+    if (out.writeSymbol == kKeepSymbol) {
+        out.writeSymbol = symbol;
+    }
+    return true;
+}
+
+void TransitionTable::setDefault(StateId state, const Transition& transition) {
+    defaults_[state] = transition;
+}
+
+const Transition* TransitionTable::getDefault(StateId state) const {
+    auto it = defaults_.find(state);
+    return it == defaults_.end() ? nullptr : &it->second;
+}
+
+std::size_t TransitionTable::eraseDefaults(const std::function<bool(StateId)>& pred) {
+    std::size_t erased = 0;
+    for (auto it = defaults_.begin(); it != defaults_.end();) {
+        if (pred(it->first)) {
+            it = defaults_.erase(it);
+            erased++;
+        } else {
+            ++it;
+        }
+    }
+    return erased;
+}
+
+void TransitionTable::set(StateId state, const Symbol& symbol, const Transition& transition) {
+    transitions_[Key{state, symbol}] = transition;
+    if (representatives_.count(symbol)) {
+        memberRuleStates_.insert(state);
+    }
+}
+
+void TransitionTable::merge(TransitionTable&& shard) {
+    for (auto& [key, transition] : shard.transitions_) {
+        set(key.state, key.symbol, transition);
+    }
+    for (auto& [state, transition] : shard.defaults_) {
+        defaults_.insert_or_assign(state, std::move(transition));
+    }
+    for (const auto& [first, line] : shard.sourceLines_) {
+        sourceLines_.insert_or_assign(first, line);
+    }
+    shard.transitions_.clear();
+    shard.defaults_.clear();
+    shard.sourceLines_.clear();
+    shard.memberRuleStates_.clear();
+}
+
+void TransitionTable::setSourceLine(StateId first, int line) {
+    sourceLines_[first] = line;
+}
+
+int TransitionTable::sourceLine(StateId state) const {
+    auto it = sourceLines_.upper_bound(state);
+    if (it == sourceLines_.begin()) {
+        return 0;
+    }
+    return std::prev(it)->second;
+}
+
+const Symbol& TransitionTable::representative(const Symbol& symbol) const {
+    auto it = representatives_.find(symbol);
+    return it == representatives_.end() ? symbol : it->second;
+}
+
+void TransitionTable::setSymbolClasses(std::unordered_map<Symbol, Symbol> representatives) {
+    representatives_ = std::move(representatives);
+    classRepresentatives_.clear();
+    for (const auto& kv : representatives_) {
+        classRepresentatives_.insert(kv.second);
+    }
+}
+
+std::size_t TransitionTable::eraseStates(const std::function<bool(StateId)>& pred) {
+    std::size_t erased = eraseDefaults(pred);
+    for (auto it = transitions_.begin(); it != transitions_.end();) {
+        if (pred(it->first.state)) {
+            it = transitions_.erase(it);
+            erased++;
+        } else {
+            ++it;
+        }
+    }
+    return erased;
+}
+
+std::size_t TransitionTable::eraseRules(const std::function<bool(StateId, const Symbol&)>& pred) {
+    std::size_t erased = 0;
+    for (auto it = transitions_.begin(); it != transitions_.end();) {
+        if (pred(it->first.state, it->first.symbol)) {
+            it = transitions_.erase(it);
+            erased++;
+        } else {
+            ++it;
+        }
+    }
+    return erased;
+}
+
 std::vector<StateId> TransitionTable::states() const {
     std::unordered_set<StateId> s;
     
@@ -39,6 +165,10 @@ std::vector<StateId> TransitionTable::states() const {
         s.insert(kv.first.state);
         s.insert(kv.second.nextState);
     }
+    for (const auto& kv : defaults_) {
+        s.insert(kv.first);
+        s.insert(kv.second.nextState);
+    }
     
     std::vector<StateId> out(s.begin(), s.end());
     std::sort(out.begin(), out.end());
@@ -52,6 +182,11 @@ std::vector<Symbol> TransitionTable::alphabet() const {
         a.insert(kv.first.symbol);
         a.insert(kv.second.writeSymbol);
     }
+    for (const auto& kv : defaults_) {
+        if (kv.second.writeSymbol != kKeepSymbol) {
+            a.insert(kv.second.writeSymbol);
+        }
+    }
     
     std::vector<Symbol> out(a.begin(), a.end());
     std::sort(out.begin(), out.end());
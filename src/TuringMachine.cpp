@@ -37,6 +37,10 @@ void Tape::set(long long position, Symbol value) {
     cells_[position] = std::move(value);
 }
 
+bool Tape::operator==(const Tape& other) const {
+    return blank_ == other.blank_ && cells_ == other.cells_;
+}
+
 void Tape::clear() {
     cells_.clear();
 }
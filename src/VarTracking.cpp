@@ -0,0 +1,462 @@
+#include "VarTracking.h"
+
+#include <bitset>
+#include <cstdint>
+
+namespace {
+
+// Возможные значения x: бит i - значение int8_t(i)
+using Values = std::bitset<256>;
+
+// После стольких итераций поиска неподвижной точки цикла x считается любым
+constexpr int kMaxFixpointIterations = 16;
+
+int toInt8(int value) {
+    return static_cast<int8_t>(static_cast<uint8_t>(value));
+}
+
+std::size_t indexOf(int value) {
+    return static_cast<uint8_t>(value);
+}
+
+Values single(int value) {
+    Values s;
+    s.set(indexOf(value));
+    return s;
+}
+
+int singleValue(const Values& s) {
+    for (std::size_t i = 0; i < s.size(); i++) {
+        if (s[i]) return toInt8(static_cast<int>(i));
+    }
+    return 0;
+}
+
+// x++ / x-- по модулю 256, как в генераторе
+Values shift(const Values& s, int delta) {
+    Values r;
+    for (std::size_t i = 0; i < s.size(); i++) {
+        if (s[i]) r.set((i + delta) & 0xFF);
+    }
+    return r;
+}
+
+std::size_t blockSize(const IRBlock& block) {
+    std::size_t n = 0;
+    for (const auto& instr : block) {
+        n += 1 + blockSize(instr->thenBranch) + blockSize(instr->elseBranch);
+    }
+    return n;
+}
+
+std::size_t countVarOps(const IRBlock& block) {
+    std::size_t n = 0;
+    for (const auto& instr : block) {
+        if (instr->type == IRType::VarSetConst || instr->type == IRType::VarInc ||
+            instr->type == IRType::VarDec) {
+            n++;
+        }
+        n += countVarOps(instr->thenBranch) + countVarOps(instr->elseBranch);
+    }
+    return n;
+}
+
+// Условие с x и чтением символа
+
+enum class Tri { False, True, Unknown };
+
+Tri fromBool(bool b) {
+    return b ? Tri::True : Tri::False;
+}
+
+bool containsReadCondition(const ConditionPtr& cond) {
+    if (!cond) return false;
+    if (cond->type == ConditionType::ReadEq || cond->type == ConditionType::ReadNeq) return true;
+    return containsReadCondition(cond->left) || containsReadCondition(cond->right) ||
+           containsReadCondition(cond->operand);
+}
+
+/** @brief Значение условия при x = value; символ под головкой неизвестен */
+Tri evaluateAt(const ConditionPtr& cond, int value) {
+    switch (cond->type) {
+    case ConditionType::VarLtConst:
+        return fromBool(toInt8(value) < toInt8(cond->intValue));
+    case ConditionType::VarGtConst:
+        return fromBool(toInt8(value) > toInt8(cond->intValue));
+    case ConditionType::ReadEq:
+    case ConditionType::ReadNeq:
+        return Tri::Unknown;
+    case ConditionType::Not: {
+        Tri t = evaluateAt(cond->operand, value);
+        return t == Tri::Unknown ? t : fromBool(t == Tri::False);
+    }
+    case ConditionType::And: {
+        Tri l = evaluateAt(cond->left, value);
+        Tri r = evaluateAt(cond->right, value);
+        if (l == Tri::False || r == Tri::False) return Tri::False;
+        return (l == Tri::True && r == Tri::True) ? Tri::True : Tri::Unknown;
+    }
+    case ConditionType::Or: {
+        Tri l = evaluateAt(cond->left, value);
+        Tri r = evaluateAt(cond->right, value);
+        if (l == Tri::True || r == Tri::True) return Tri::True;
+        return (l == Tri::False && r == Tri::False) ? Tri::False : Tri::Unknown;
+    }
+    case ConditionType::Xor: {
+        Tri l = evaluateAt(cond->left, value);
+        Tri r = evaluateAt(cond->right, value);
+        if (l == Tri::Unknown || r == Tri::Unknown) return Tri::Unknown;
+        return fromBool(l != r);
+    }
+    }
+    return Tri::Unknown;
+}
+
+/** @brief Значения x, при которых условие может дать outcome */
+Values filter(const Values& s, const ConditionPtr& cond, bool outcome) {
+    if (!cond) return outcome ? s : Values();
+    Values r;
+    for (std::size_t i = 0; i < s.size(); i++) {
+        if (!s[i]) continue;
+        Tri t = evaluateAt(cond, static_cast<int>(i));
+        if (t == Tri::Unknown || t == fromBool(outcome)) r.set(i);
+    }
+    return r;
+}
+
+/** @brief Условие после подстановки известных сравнений x */
+struct Folded {
+    Tri value;           // True/False - условие решено целиком
+    ConditionPtr cond;   // Остаток при Unknown
+};
+
+Folded fold(IRArena& arena, const ConditionPtr& cond, const Values& x) {
+    switch (cond->type) {
+    case ConditionType::ReadEq:
+    case ConditionType::ReadNeq:
+        return {Tri::Unknown, cond};
+    case ConditionType::VarLtConst:
+    case ConditionType::VarGtConst: {
+        const bool canBeTrue = filter(x, cond, true).any();
+        const bool canBeFalse = filter(x, cond, false).any();
+        if (canBeTrue != canBeFalse) {
+            return {fromBool(canBeTrue), nullptr};
+        }
+        return {Tri::Unknown, cond};
+    }
+    case ConditionType::Not: {
+        Folded op = fold(arena, cond->operand, x);
+        if (op.value != Tri::Unknown) return {fromBool(op.value == Tri::False), nullptr};
+        return {Tri::Unknown, op.cond == cond->operand ? cond : Condition::notOp(arena, op.cond)};
+    }
+    case ConditionType::And:
+    case ConditionType::Or:
+    case ConditionType::Xor: {
+        Folded l = fold(arena, cond->left, x);
+        Folded r = fold(arena, cond->right, x);
+        if (l.value != Tri::Unknown && r.value != Tri::Unknown) {
+            const bool lv = l.value == Tri::True;
+            const bool rv = r.value == Tri::True;
+            switch (cond->type) {
+            case ConditionType::And: return {fromBool(lv && rv), nullptr};
+            case ConditionType::Or:  return {fromBool(lv || rv), nullptr};
+            default:                 return {fromBool(lv != rv), nullptr};
+            }
+        }
+        if (l.value == Tri::Unknown && r.value == Tri::Unknown) {
+            if (l.cond == cond->left && r.cond == cond->right) return {Tri::Unknown, cond};
+            return {Tri::Unknown, Condition::binaryOp(arena, cond->type, l.cond, r.cond)};
+        }
+        // Известна ровно одна сторона
+        const bool known = (l.value != Tri::Unknown ? l.value : r.value) == Tri::True;
+        const ConditionPtr& rest = (l.value != Tri::Unknown) ? r.cond : l.cond;
+        switch (cond->type) {
+        case ConditionType::And: return known ? Folded{Tri::Unknown, rest} : Folded{Tri::False, nullptr};
+        case ConditionType::Or:  return known ? Folded{Tri::True, nullptr} : Folded{Tri::Unknown, rest};
+        default:                 return {Tri::Unknown, known ? Condition::notOp(arena, rest) : rest};
+        }
+    }
+    }
+    return {Tri::Unknown, cond};
+}
+
+// Анализ без изменения IR
+
+Values analyzeBlock(const IRBlock& block, Values x);
+
+/** @brief Множество значений x в голове цикла (неподвижная точка) */
+Values analyzeLoopHead(const ConditionPtr& cond, const IRBlock& body, const Values& entry) {
+    Values head = entry;
+    for (int i = 0; ; i++) {
+        Values next = head | analyzeBlock(body, filter(head, cond, true));
+        if (next == head) return head;
+        if (i >= kMaxFixpointIterations) return Values().set();
+        head = next;
+    }
+}
+
+Values analyzeInstruction(const IRInstruction& instr, const Values& x) {
+    switch (instr.type) {
+    case IRType::VarSetConst:
+        return single(instr.intValue);
+    case IRType::VarInc:
+        return shift(x, 1);
+    case IRType::VarDec:
+        return shift(x, -1);
+    case IRType::IfElse:
+        return analyzeBlock(instr.thenBranch, filter(x, instr.condition, true)) |
+               analyzeBlock(instr.elseBranch, filter(x, instr.condition, false));
+    case IRType::While:
+        return filter(analyzeLoopHead(instr.condition, instr.thenBranch, x), instr.condition, false);
+    default:
+        return x;
+    }
+}
+
+Values analyzeBlock(const IRBlock& block, Values x) {
+    for (const auto& instr : block) {
+        x = analyzeInstruction(*instr, x);
+    }
+    return x;
+}
+
+// Переписывание IR
+
+/**
+ * @brief Состояние x в точке программы
+ *
+ * synced == false: значение x известно (ровно одно), но в память ещё не
+ * записано - содержимое памяти не важно, пока его никто не читает.
+ */
+struct State {
+    Values x;
+    bool synced{true};
+    int line{0};
+    int column{0};
+};
+
+class Rewriter {
+public:
+    Rewriter(IRArena& arena, std::size_t unrollBudget) : arena_(arena), unrollBudget_(unrollBudget) {}
+
+    void rewriteBlock(const IRBlock& block, State& state, IRBlock& out) {
+        for (const auto& instr : block) {
+            rewriteInstruction(instr, state, out);
+        }
+    }
+
+    /** @brief Записать отложенное значение x в память */
+    void materialize(State& state, IRBlock& out) {
+        if (!state.synced && state.x.count() == 1) {
+            out.push_back(IRInstruction::varSetConst(arena_, singleValue(state.x), state.line, state.column));
+        }
+        state.synced = true;
+    }
+
+    VarTrackingStats stats;
+
+private:
+    void rewriteInstruction(IRInstruction* instr, State& state, IRBlock& out) {
+        switch (instr->type) {
+        case IRType::VarSetConst:
+        case IRType::VarInc:
+        case IRType::VarDec: {
+            Values next = analyzeInstruction(*instr, state.x);
+            if (next.count() == 1) {
+                // Результат известен - откладываем запись
+                state.x = next;
+                state.synced = false;
+                state.line = instr->line;
+                state.column = instr->column;
+            } else {
+                out.push_back(instr);
+                state.x = next;
+            }
+            return;
+        }
+        case IRType::IfElse:
+            rewriteIf(*instr, state, out);
+            return;
+        case IRType::While:
+            rewriteWhile(*instr, state, out);
+            return;
+        default:
+            out.push_back(instr);
+            return;
+        }
+    }
+
+    void rewriteIf(const IRInstruction& instr, State& state, IRBlock& out) {
+        Folded f = fold(arena_, instr.condition, state.x);
+        if (f.value != Tri::Unknown) {
+            stats.foldedConditions++;
+            rewriteBlock(f.value == Tri::True ? instr.thenBranch : instr.elseBranch, state, out);
+            return;
+        }
+        if (f.cond != instr.condition) {
+            stats.foldedConditions++;
+        }
+        if (containsVarCondition(f.cond)) {
+            materialize(state, out);
+        }
+
+        State thenState = state;
+        State elseState = state;
+        thenState.x = filter(state.x, f.cond, true);
+        elseState.x = filter(state.x, f.cond, false);
+
+        IRBlock thenBlock, elseBlock;
+        rewriteBlock(instr.thenBranch, thenState, thenBlock);
+        rewriteBlock(instr.elseBranch, elseState, elseBlock);
+
+        if (!thenState.synced && !elseState.synced && thenState.x == elseState.x) {
+            // Обе ветки пришли к одному значению - запись можно отложить дальше
+            state = thenState;
+        } else {
+            materialize(thenState, thenBlock);
+            materialize(elseState, elseBlock);
+            state.x = thenState.x | elseState.x;
+            state.synced = true;
+        }
+        out.push_back(IRInstruction::ifElse(arena_, f.cond, std::move(thenBlock), std::move(elseBlock),
+                                            instr.line, instr.column));
+    }
+
+    void rewriteWhile(const IRInstruction& instr, State& state, IRBlock& out) {
+        if (tryUnroll(instr, state, out)) {
+            return;
+        }
+
+        const Values head = analyzeLoopHead(instr.condition, instr.thenBranch, state.x);
+        Folded f = fold(arena_, instr.condition, head);
+        if (f.value == Tri::False) {
+            // Цикл не выполняется ни разу
+            stats.foldedConditions++;
+            return;
+        }
+        // Бесконечный по x цикл оставляем с исходным условием
+        ConditionPtr cond = (f.value == Tri::True) ? instr.condition : f.cond;
+        if (f.value == Tri::Unknown && f.cond != instr.condition) {
+            stats.foldedConditions++;
+        }
+
+        // Отложенная запись переживает цикл, только если x в нём не меняется
+        // и условие не читает память
+        if (containsVarCondition(cond) || head.count() != 1) {
+            materialize(state, out);
+        }
+
+        State bodyState = state;
+        bodyState.x = filter(head, cond, true);
+        IRBlock body;
+        rewriteBlock(instr.thenBranch, bodyState, body);
+        if (state.synced) {
+            materialize(bodyState, body);
+        }
+
+        out.push_back(IRInstruction::whileLoop(arena_, cond, std::move(body), instr.line, instr.column));
+        state.x = filter(head, cond, false);
+    }
+
+    /** @brief Развернуть цикл по x с известным значением на входе */
+    bool tryUnroll(const IRInstruction& instr, State& state, IRBlock& out) {
+        if (unrollBudget_ == 0 || state.x.count() != 1 ||
+            !containsVarCondition(instr.condition) || containsReadCondition(instr.condition)) {
+            return false;
+        }
+
+        const VarTrackingStats saved = stats;
+        State iter = state;
+        IRBlock unrolled;
+        std::size_t trips = 0;
+        while (true) {
+            Folded f = fold(arena_, instr.condition, iter.x);
+            if (f.value == Tri::False) break;
+            if (f.value != Tri::True || ++trips > unrollBudget_) {
+                stats = saved;
+                return false;
+            }
+            rewriteBlock(instr.thenBranch, iter, unrolled);
+            if (iter.x.count() != 1 || blockSize(unrolled) > unrollBudget_) {
+                stats = saved;
+                return false;
+            }
+        }
+
+        if (trips == 0) {
+            stats.foldedConditions++;
+        } else {
+            stats.unrolledLoops++;
+        }
+        out.insert(out.end(), unrolled.begin(), unrolled.end());
+        state = iter;
+        return true;
+    }
+
+    IRArena& arena_;
+    std::size_t unrollBudget_;
+};
+
+/**
+ * @brief Удалить операции, чей результат перезаписывается до чтения
+ * @param liveOut Может ли x быть прочитан после блока
+ * @return Может ли x быть прочитан перед блоком
+ */
+bool removeDeadVarOps(IRBlock& block, bool liveOut) {
+    bool live = liveOut;
+    IRBlock kept;
+    for (auto it = block.rbegin(); it != block.rend(); ++it) {
+        const auto& instr = *it;
+        switch (instr->type) {
+        case IRType::VarSetConst:
+            if (!live) continue;
+            live = false;
+            break;
+        case IRType::VarInc:
+        case IRType::VarDec:
+            if (!live) continue;
+            break;
+        case IRType::IfElse: {
+            bool thenLive = removeDeadVarOps(instr->thenBranch, live);
+            bool elseLive = removeDeadVarOps(instr->elseBranch, live);
+            live = thenLive || elseLive || containsVarCondition(instr->condition);
+            break;
+        }
+        case IRType::While:
+            // Тело может читать x следующей итерации - считаем его живым
+            removeDeadVarOps(instr->thenBranch, true);
+            live = live || containsVarCondition(instr->condition) ||
+                   countVarOps(instr->thenBranch) > 0;
+            break;
+        default:
+            break;
+        }
+        kept.push_back(instr);
+    }
+    block.assign(kept.rbegin(), kept.rend());
+    return live;
+}
+
+} // namespace
+
+VarTrackingStats trackVariable(IRBlock& instructions, IRArena& arena, std::size_t unrollBudget) {
+    const std::size_t varOpsBefore = countVarOps(instructions);
+
+    // На старте память обнулена
+    State state;
+    state.x = single(0);
+
+    Rewriter rewriter(arena, unrollBudget);
+    IRBlock result;
+    rewriter.rewriteBlock(instructions, state, result);
+    // Значение x остаётся на ленте - в конце память должна быть верной
+    rewriter.materialize(state, result);
+    removeDeadVarOps(result, true);
+
+    VarTrackingStats stats = rewriter.stats;
+    const std::size_t varOpsAfter = countVarOps(result);
+    stats.removedVarOps = varOpsBefore > varOpsAfter ? varOpsBefore - varOpsAfter : 0;
+
+    instructions = std::move(result);
+    return stats;
+}
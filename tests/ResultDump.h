@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Compiler.h"
+
+/**
+ * @brief Результат компиляции строкой, не зависящей от порядка обхода таблицы
+ *
+ * Правила и правила по умолчанию, отметки строк, алфавит и диагностика -
+ * кроме статистики кэша, которая у повторной компиляции своя.
+ */
+inline std::string dump(const CompileResult& result) {
+    std::vector<std::string> rows;
+    result.table.forEach([&](StateId state, const Symbol& symbol, const Transition& t) {
+        rows.push_back(std::to_string(state) + " " + symbol + " -> " + std::to_string(t.nextState) + " " +
+                       t.writeSymbol + " " + std::to_string(static_cast<int>(t.move)));
+    });
+    result.table.forEachDefault([&](StateId state, const Transition& t) {
+        rows.push_back(std::to_string(state) + " * -> " + std::to_string(t.nextState) + " " +
+                       t.writeSymbol + " " + std::to_string(static_cast<int>(t.move)));
+    });
+    std::sort(rows.begin(), rows.end());
+
+    std::string out = std::to_string(result.ok) + " " + std::to_string(result.table.startState) + " " +
+                      std::to_string(result.table.haltState) + "\n";
+    for (const auto& row : rows) {
+        out += row + "\n";
+    }
+    result.table.forEachSourceLine([&](StateId first, int line) {
+        out += "L" + std::to_string(first) + "=" + std::to_string(line) + "\n";
+    });
+    for (const auto& symbol : result.alphabet) {
+        out += symbol + "|";
+    }
+    out += "\n";
+    for (const auto& d : result.diagnostics) {
+        if (d.message.rfind("Кэш", 0) != 0) {
+            out += std::to_string(d.line) + ":" + std::to_string(d.column) + " " + d.message + "\n";
+        }
+    }
+    return out;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file compile_cache.cpp
+ * @brief Повторная компиляция с CompileCache даёт то же, что compile(source)
+ *
+ * Документ правится так, как это бывает в редакторе: комментарии, пустые
+ * строки и отступы над процедурами, правка тела. После каждой правки
+ * результат с кэшем сравнивается с компиляцией с нуля - вместе с отметками
+ * строк и позициями диагностики. Сдвиг процедур в тексте не должен мешать
+ * переиспользованию. Код возврата 0 - все совпали.
+ */
+
+#include "CompileCache.h"
+#include "Compiler.h"
+#include "ResultDump.h"
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const kDocuments[] = {
+    R"(Set_alphabet "a b";
+Setup "a a b";
+proc step() { move_right; }
+proc back() { move_left; }
+proc main() {
+    call step; call step;
+    if (read == "b" xor read == "a") { write "a"; }
+    while (read != "blank") { call back; }
+    write "b";
+    x = -3;
+    while (x < 0) { call step; x++; }
+}
+)",
+    R"(Set_alphabet "a b c";
+Setup "blank a c blank blank c";
+proc p0() { x++; while (read != "a") { x--; x = 5; move_right; } }
+proc p1() { call p0; }
+proc unused() { write "c"; }
+proc main() {
+    move_right; write "b";
+    if (read == "a") { x = 6; if (read != "b") { move_right; } } x--;
+    if (read != "b") { while (read != "c") { call p1; move_right; } x--; }
+    write "blank";
+}
+)",
+};
+
+/** @brief Вставить text перед первым вхождением where (если оно есть) */
+std::string insertBefore(std::string source, const std::string& where, const std::string& text) {
+    const std::size_t pos = source.find(where);
+    if (pos != std::string::npos) {
+        source.insert(pos, text);
+    }
+    return source;
+}
+
+/** @brief Заменить первое вхождение from на to */
+std::string replaceFirst(std::string source, const std::string& from, const std::string& to) {
+    const std::size_t pos = source.find(from);
+    if (pos != std::string::npos) {
+        source.replace(pos, from.size(), to);
+    }
+    return source;
+}
+
+struct Edit {
+    const char* name;
+    std::function<std::string(const std::string&)> apply;
+};
+
+} // namespace
+
+int main() {
+    const std::vector<Edit> edits = {
+        {"без изменений", [](const std::string& s) { return s; }},
+        {"комментарий в конце", [](const std::string& s) { return s + "\n// конец\n"; }},
+        {"комментарий в начале", [](const std::string& s) { return "// начало\n" + s; }},
+        {"строки над main", [](const std::string& s) { return insertBefore(s, "proc main", "\n\n"); }},
+        {"строка над первой процедурой", [](const std::string& s) { return insertBefore(s, "proc", "\n"); }},
+        {"отступ перед процедурой", [](const std::string& s) { return insertBefore(s, "proc", "  "); }},
+        {"правка тела", [](const std::string& s) { return replaceFirst(s, "move_right", "move_left"); }},
+        {"исходный текст", [](const std::string& s) { return s; }},
+    };
+
+    const Compiler compiler;
+    int failures = 0;
+    for (const char* document : kDocuments) {
+        CompileCache cache;
+        compiler.compile(document, cache);
+
+        for (const Edit& edit : edits) {
+            const std::string source = edit.apply(document);
+            const CompileResult cached = compiler.compile(source, cache);
+            if (!cached.ok || dump(cached) != dump(compiler.compile(source))) {
+                std::cerr << "Правка '" << edit.name << "': результат с кэшем отличается\n";
+                failures++;
+            } else if (cache.reusedProcedures == 0) {
+                std::cerr << "Правка '" << edit.name << "': процедуры разобраны заново\n";
+                failures++;
+            }
+        }
+    }
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "Повторная компиляция совпала с компиляцией с нуля\n";
+    return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file compile_stress.cpp
+ * @brief Параллельная компиляция: таблицы из разных потоков совпадают с последовательными
+ *
+ * Набор разных программ компилируется по очереди в одном потоке, затем
+ * одновременно в нескольких std::thread одним и тем же Compiler. Каждый
+ * результат сравнивается с последовательным: правила, правила по умолчанию,
+ * отметки строк и алфавит. Код возврата 0 - все совпали.
+ */
+
+#include "CompileCache.h"
+#include "Compiler.h"
+#include "ResultDump.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* const kPrograms[] = {
+    R"(Set_alphabet "1 0";
+Setup "";
+proc main() {
+    x = 0;
+    while (x < 3) {
+        write "1";
+        move_right;
+        x++;
+    }
+}
+)",
+    R"(Set_alphabet "a b c";
+Setup "a b a c b";
+proc main() {
+    while (read != "blank") {
+        if (read == "a") { write "b"; } else { if (read == "b") { write "a"; } else { write "c"; } }
+        move_right;
+    }
+    move_left;
+    move_left; move_left; move_left; move_left; move_left; move_left;
+    write "a";
+    x = 5;
+    x--;
+    if (x > 3 and read == "a") { write "c"; }
+}
+)",
+    R"(Set_alphabet "a b";
+Setup "a a b";
+proc step() { move_right; }
+proc back() { move_left; }
+proc main() {
+    call step; call step;
+    if (read == "b" xor read == "a") { write "a"; }
+    while (read != "blank") { call back; }
+    write "b";
+    call back; call back;
+    write "a";
+    x = -3;
+    while (x < 0) { call step; x++; }
+    write "b";
+}
+)",
+    R"(Set_alphabet "a b c";
+Setup "blank a c blank blank c";
+proc p0() { x++; while (read != "a") { x--; x = 5; move_right; } }
+proc p1() { call p0; }
+proc main() {
+    move_right; write "b"; write "c";
+    if (read == "a") { x = 6; if (read != "b") { move_right; move_right; } if (read == "a") { x--; move_left; } else {  } }
+    x--; write "blank";
+    if (read != "b") { while (read != "c") { call p0; move_right; } x--; }
+    write "blank";
+}
+)",
+    R"(Set_alphabet "a b";
+Setup "a b a b";
+proc p0() { move_left; while (read != "b") { x = 3; move_left; } }
+proc p1() { move_right; x--; }
+proc main() {
+    if (read == "b") { x = 4; } else { if (x > 5) { write "b"; } }
+    move_left; x--;
+    call p0; call p1;
+}
+)",
+    R"(Set_alphabet "a b";
+Setup "";
+proc p1() { move_left; while ((read != "blank" or read != "a")) {  move_right; } x--; }
+proc main() {
+    x++; while (read != "a") {  move_right; }
+    move_right; x--; move_right; x = 4; x = 5; x--; move_right;
+}
+)",
+    R"(Set_alphabet "a b c d";
+Setup "c blank";
+proc p1() { if ((read == "d" or read == "a")) { move_right; } x = -3; if (read == "b") {  } }
+proc main() {
+    while ((not read == "b" and read == "d")) { if (x < 1) {  } else {  } move_right; }
+    x = -3; call p1;
+}
+)",
+};
+
+} // namespace
+
+int main() {
+    constexpr std::size_t kProgramCount = sizeof(kPrograms) / sizeof(kPrograms[0]);
+    constexpr int kRounds = 4;
+    const Compiler compiler;
+
+    // Последовательный прогон - эталон
+    std::vector<std::string> expected;
+    for (const char* source : kPrograms) {
+        const CompileResult result = compiler.compile(source);
+        if (!result.ok) {
+            std::cerr << "Программа " << expected.size() << " не компилируется\n";
+            return 1;
+        }
+        expected.push_back(dump(result));
+    }
+
+    // Потоки начинают с разных программ, чтобы одновременно шли разные компиляции
+    const unsigned threadCount = std::max(4u, std::thread::hardware_concurrency());
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t] {
+            CompileCache cache;  // Кэш у каждого потока свой: он не потокобезопасен
+            for (int round = 0; round < kRounds; round++) {
+                for (std::size_t i = 0; i < kProgramCount; i++) {
+                    const std::size_t index = (i + t) % kProgramCount;
+                    const CompileResult result = (round % 2 == 0) ? compiler.compile(kPrograms[index])
+                                                                  : compiler.compile(kPrograms[index], cache);
+                    if (dump(result) != expected[index]) {
+                        mismatches++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (mismatches > 0) {
+        std::cerr << "Расхождений с последовательной компиляцией: " << mismatches << "\n";
+        return 1;
+    }
+    std::cout << "Скомпилировано " << threadCount * kRounds * kProgramCount << " раз в " << threadCount
+              << " потоках, расхождений нет\n";
+    return 0;
+}